@@ -0,0 +1,284 @@
+// (c) Copyright [2022-2023] Micro Focus or one of its affiliates.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// DBLink fetch/conversion benchmark. Runs the whole DBLink call (describe, setup,
+// processPartition, destroy) outside Vertica:
+//
+//   - make bench: against the mock ODBC driver (mock_odbc.cpp), one query per column type and
+//     rowset, to measure DBLink own cost (binding, fetch loop, conversion, output)
+//   - make bench_e2e: against a real driver manager/driver, running --query on --connect
+//
+// With --source the rows go through the DBLinkSource COPY source (NATIVE format) instead.
+//
+// Usage: dblink_bench [--rows N] [--rowset N[,N...]] [--types "TYPE TYPE..."]
+//                     [--connect CS] [--query Q] [--param NAME=VALUE]... [--source] [--verbose]
+//
+// TYPE is a mock column spec, for example int, numeric(18,4), varchar(256)~0.1 (10% NULLs).
+// Each --param is passed to DBLink as is (true/false become BOOLEAN, digits INTEGER).
+
+#include "../ldblink.cpp"
+
+#include <iomanip>
+
+namespace {
+
+struct Options {
+	size_t rows ;
+	size_t partitions ;
+	std::vector<long> rowsets ;
+	std::vector<std::string> types ;
+	std::string connect ;
+	std::string query ;
+	std::vector<std::pair<std::string, std::string> > params ;
+	bool source ;
+	bool verbose ;
+	Options () : rows(1000000), partitions(1), connect("DSN=mock"), source(false), verbose(false) { }
+} ;
+
+struct Result {
+	size_t rows ;
+	size_t bytes ;
+	double secs ;
+} ;
+
+void usage ( const char *prog ) {
+	fprintf(stderr, "Usage: %s [--rows N] [--rowset N[,N...]] [--types \"TYPE TYPE...\"] [--connect CS] [--query Q] "
+		"[--param NAME=VALUE]... [--partitions N] [--source] [--verbose]\n", prog) ;
+	exit(2) ;
+}
+
+void set_param ( ParamReader &p, const std::string &name, const std::string &value ) {
+	if ( value == "true" || value == "false" )
+		p.setBool(name, value == "true") ;
+	else if ( !value.empty() && value.find_first_not_of("0123456789") == std::string::npos )
+		p.setInt(name, atol(value.c_str())) ;
+	else
+		p.setString(name, value) ;
+}
+
+// One DBLink call, timed from getReturnType to destroy
+Result run ( const Options &o, const std::string &query, long rowset ) {
+	ServerInterface srv ;
+	srv.verbose = o.verbose ;
+	srv.params.setString("connect", o.connect) ;
+	srv.params.setString("query", query) ;
+	srv.params.setInt("rowset", rowset) ;
+	for ( size_t i = 0 ; i < o.params.size() ; i++ )
+		set_param(srv.params, o.params[i].first, o.params[i].second) ;
+
+	DBLinkFactory dbf ;
+	TransformFunctionFactory &factory = dbf ;
+	SizedColumnTypes in, out ;
+	PartitionReader reader ;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+	factory.getReturnType(srv, in, out) ;
+	PartitionWriter writer(out) ;
+	std::unique_ptr<TransformFunction> f(factory.createTransformFunction(srv)) ;
+	f->setup(srv, in) ;
+	f->processPartition(srv, reader, writer) ;
+	// Next partitions of the same instance reuse its buffers: the allocator must not grow
+	size_t used = srv.allocator->bytes, first = writer.rows ;
+	for ( size_t p = 1 ; p < o.partitions ; p++ )
+		f->processPartition(srv, reader, writer) ;
+	if ( srv.allocator->bytes != used )
+		throw std::runtime_error("allocator grew by " + std::to_string((long long)( srv.allocator->bytes - used )) +
+			" bytes after the first partition") ;
+	// Each partition returns the whole result: the mock ignores the WHERE clauses of slices, so
+	// split_column returns it once per slice
+	size_t expected = o.partitions * ( o.query.empty() && !srv.params.containsParameter("split_column") ? o.rows : first ) ;
+	if ( writer.rows != expected )
+		throw std::runtime_error(std::to_string((long long)writer.rows) + " rows in " + std::to_string((long long)o.partitions) +
+			" partitions, expected " + std::to_string((long long)expected)) ;
+	f->destroy(srv, in) ;
+	Result r ;
+	r.secs = secs_since(t0) ;
+	r.rows = writer.rows ;
+	r.bytes = writer.bytes ;
+	return r ;
+}
+
+// Rows of a NATIVE stream, counted as it is read: header, then row length, NULL bits and data
+struct NativeCounter {
+	size_t rows = 0 ;
+	size_t bytes = 0 ;
+	size_t ncol = 0 ;
+	int state = 0 ;			// 0: signature and header length, 1: header, 2: row length, 3: row
+	size_t need = 15 ;
+	std::string hold ;
+
+	void feed ( const char *p, size_t n ) {
+		bytes += n ;
+		while ( n ) {
+			size_t k = std::min(n, need) ;
+			if ( state != 3 )
+				hold.append(p, k) ;
+			p += k ;
+			n -= k ;
+			need -= k ;
+			if ( need )
+				return ;
+			uint32 v = 0 ;
+			if ( state == 0 ) {
+				if ( hold.compare(0, 11, std::string("NATIVE\n\377\r\n\0", 11)) )
+					throw std::runtime_error("bad NATIVE signature") ;
+				memcpy(&v, hold.data() + 11, 4) ;
+				state = 1 ;
+				need = v ;
+			} else if ( state == 1 ) {
+				uint16 c ;
+				memcpy(&c, hold.data() + 3, 2) ;
+				ncol = c ;
+				state = 2 ;
+				need = 4 ;
+			} else if ( state == 2 ) {
+				memcpy(&v, hold.data(), 4) ;
+				state = 3 ;
+				need = ( ncol + 7 ) / 8 + v ;
+			} else {
+				rows++ ;
+				state = 2 ;
+				need = 4 ;
+			}
+			hold.clear() ;
+			if ( !need && state == 3 ) {
+				rows++ ;
+				state = 2 ;
+				need = 4 ;
+			}
+		}
+	}
+} ;
+
+// One COPY ... WITH SOURCE DBLinkSource(), timed from plan to destroy
+Result run_source ( const Options &o, const std::string &query, long rowset ) {
+	ServerInterface srv ;
+	srv.verbose = o.verbose ;
+	srv.params.setString("connect", o.connect) ;
+	srv.params.setString("query", query) ;
+	srv.params.setInt("rowset", rowset) ;
+	for ( size_t i = 0 ; i < o.params.size() ; i++ )
+		set_param(srv.params, o.params[i].first, o.params[i].second) ;
+
+	DBLinkSourceFactory dsf ;
+	SourceFactory &factory = dsf ;
+	NodeSpecifyingPlanContext plan ;
+	Result r = { 0, 0, 0 } ;
+	std::vector<char> buf(1 << 20) ;
+	plan.nodes.push_back(srv.getCurrentNodeName()) ;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+	factory.plan(srv, plan) ;
+	std::vector<UDSource *> sources = factory.prepareUDSources(srv, plan) ;
+	for ( size_t i = 0 ; i < sources.size() ; i++ ) {
+		std::unique_ptr<UDSource> src(sources[i]) ;
+		NativeCounter counter ;			// each source is a NATIVE stream
+		StreamState st ;
+		src->setup(srv) ;
+		do {
+			DataBuffer db = { buf.data(), buf.size(), 0 } ;
+			st = src->process(srv, db) ;
+			counter.feed(db.buf, db.offset) ;
+		} while ( st != DONE ) ;
+		src->destroy(srv) ;
+		r.rows += counter.rows ;
+		r.bytes += counter.bytes ;
+	}
+	r.secs = secs_since(t0) ;
+	return r ;
+}
+
+void print ( const std::string &label, long rowset, const Result &r ) {
+	std::cout << std::left << std::setw(28) << label << std::right
+		<< std::setw(8) << rowset
+		<< std::setw(12) << r.rows
+		<< std::setw(10) << std::fixed << std::setprecision(3) << r.secs
+		<< std::setw(14) << std::setprecision(0) << r.rows / r.secs
+		<< std::setw(10) << std::setprecision(1) << r.bytes / r.secs / 1048576
+		<< std::endl ;
+}
+
+} // namespace
+
+int main ( int argc, char **argv ) {
+	Options o ;
+	std::string types = "int bigint double numeric(18,4) numeric(38,10) varchar(32) varchar(256)~0.1 "
+		"wvarchar(64) date timestamp bit" ;
+	std::string rowsets = "1,10,100,1000" ;			// up to MAX_ROWSET
+
+	for ( int i = 1 ; i < argc ; i++ ) {
+		std::string a = argv[i] ;
+		if ( a == "--verbose" ) {
+			o.verbose = true ;
+			continue ;
+		}
+		if ( a == "--source" ) {
+			o.source = true ;
+			continue ;
+		}
+		if ( i + 1 >= argc )
+			usage(argv[0]) ;
+		std::string v = argv[++i] ;
+		if ( a == "--rows" ) {
+			o.rows = strtoull(v.c_str(), NULL, 10) ;
+		} else if ( a == "--rowset" ) {
+			rowsets = v ;
+		} else if ( a == "--partitions" ) {
+			o.partitions = std::max(strtoull(v.c_str(), NULL, 10), 1ULL) ;
+		} else if ( a == "--types" ) {
+			types = v ;
+		} else if ( a == "--connect" ) {
+			o.connect = v ;
+		} else if ( a == "--query" ) {
+			o.query = v ;
+		} else if ( a == "--param" && v.find('=') != std::string::npos ) {
+			o.params.push_back(std::make_pair(v.substr(0, v.find('=')), v.substr(v.find('=') + 1))) ;
+		} else {
+			usage(argv[0]) ;
+		}
+	}
+	std::istringstream rs(rowsets) ;
+	for ( std::string s ; std::getline(rs, s, ',') ; )
+		o.rowsets.push_back(atol(s.c_str())) ;
+	std::istringstream ts(types) ;
+	for ( std::string s ; ts >> s ; )
+		o.types.push_back(s) ;
+
+	// Queries: the given one (e2e), or one per mock column type plus all of them together
+	std::vector<std::pair<std::string, std::string> > queries ;
+	if ( !o.query.empty() ) {
+		queries.push_back(std::make_pair(std::string("query"), o.query)) ;
+	} else {
+		std::string all ;
+		for ( size_t i = 0 ; i < o.types.size() ; i++ ) {
+			queries.push_back(std::make_pair(o.types[i], "SELECT " + o.types[i] + " FROM mock ROWS " + std::to_string((long long)o.rows))) ;
+			all += ( i ? ", " : "" ) + o.types[i] ;
+		}
+		if ( o.types.size() > 1 )
+			queries.push_back(std::make_pair(std::string("all"), "SELECT " + all + " FROM mock ROWS " + std::to_string((long long)o.rows))) ;
+	}
+
+	std::cout << std::left << std::setw(28) << "type" << std::right << std::setw(8) << "rowset" << std::setw(12) << "rows"
+		<< std::setw(10) << "secs" << std::setw(14) << "rows/s" << std::setw(10) << "MB/s" << std::endl ;
+	int ret = 0 ;
+	for ( size_t q = 0 ; q < queries.size() ; q++ ) {
+		for ( size_t r = 0 ; r < o.rowsets.size() ; r++ ) {
+			try {
+				print(queries[q].first, o.rowsets[r], o.source ? run_source(o, queries[q].second, o.rowsets[r]) :
+					run(o, queries[q].second, o.rowsets[r])) ;
+			} catch ( std::exception &e ) {
+				std::cerr << queries[q].first << " rowset " << o.rowsets[r] << ": " << e.what() << std::endl ;
+				ret = 1 ;
+			}
+		}
+	}
+	return ret ;
+}
@@ -0,0 +1,835 @@
+// (c) Copyright [2022-2023] Micro Focus or one of its affiliates.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// In-process mock ODBC driver for the DBLINK benchmark. It implements the ODBC calls used by
+// ldblink.cpp (linked instead of the driver manager) and returns synthetic result sets
+// described by the query text:
+//
+//     SELECT <column>[, <column>...] FROM mock ROWS <n>
+//
+// where each column is "<type>[(<size>[,<scale>])][~<null ratio>]" and <type> is one of
+// int, bigint, double, numeric, char, varchar, wchar, wvarchar, longvarchar, wlongvarchar,
+// varbinary, date, time, timestamp, bit. "SELECT 1 FROM DUAL" (type probe) returns one int row.
+// Other statements have no result set: "... ROWS <n>" sets their
+// SQLRowCount and statements containing FAIL return an error when executed. Values are pre-rendered in the bound C type once per execution,
+// so fetching costs about what a fast driver costs: a copy per value.
+//
+// Connection string options (DSN and others are ignored):
+//     DBMS=<name>      SQL_DBMS_NAME returned to DBLINK (default "Mock")
+//     NOBIGINT=1       fail fetches into SQL_C_SBIGINT bindings, like drivers lacking it
+//     LATENCY_US=<n>   sleep n microseconds in each SQLFetchScroll (network round trip)
+//     EXEC_MS=<n>      executions take n milliseconds (remote query time)
+//     ASYNC=1          support statement level asynchronous execution (SQL_AM_STATEMENT)
+
+#include <sql.h>
+#include <sqlext.h>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cctype>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+namespace {
+
+#define MOCK_VALUES		997			// Distinct values per column (cycled)
+#define MOCK_NULLS		1009		// Length of the NULL pattern per column (cycled)
+#define MOCK_VALUES_MB	64			// Max memory for the values of one column
+
+struct Handle {
+	SQLSMALLINT type ;
+	std::string diag ;				// Last error message...
+	std::string state ;				// ...and its SQLSTATE
+	Handle ( SQLSMALLINT t ) : type(t) { }
+	virtual ~Handle () { }
+	SQLRETURN error ( const std::string &msg, const char *sqlstate = "HY000" ) {
+		diag = msg ;
+		state = sqlstate ;
+		return SQL_ERROR ;
+	}
+} ;
+
+struct Env : Handle {
+	Env () : Handle(SQL_HANDLE_ENV) { }
+} ;
+
+struct Dbc : Handle {
+	std::string dbms ;
+	bool nobigint ;
+	long latency ;
+	long exec_ms ;
+	bool async ;
+	Dbc () : Handle(SQL_HANDLE_DBC), dbms("Mock"), nobigint(false), latency(0), exec_ms(0), async(false) { }
+} ;
+
+// Result set column and its synthetic values (canonical form)
+struct Col {
+	SQLSMALLINT sqlt ;
+	SQLULEN size ;
+	SQLSMALLINT scale ;
+	double nulls ;
+	std::vector<long long> iv ;		// integers, scaled numerics, days, microseconds
+	std::vector<double> dv ;		// doubles
+	std::vector<std::string> sv ;	// strings (UTF-8) and the text of every value
+	std::vector<bool> null ;		// NULL pattern
+} ;
+
+// Bound (or read with SQLGetData) column rendered in its C type
+struct Bind {
+	SQLSMALLINT ctype ;
+	SQLPOINTER data ;
+	SQLLEN len ;
+	SQLLEN *ind ;
+	SQLSMALLINT prec, scale ;		// SQL_C_NUMERIC (application row descriptor)
+	SQLSMALLINT rctype ;			// C type of the rendered values (0: not rendered)
+	size_t width ;					// Rendered value size
+	std::vector<char> vals ;		// Rendered values, "width" bytes each
+	std::vector<SQLLEN> lens ;		// Rendered values lengths
+	Bind () : ctype(0), data(0), len(0), ind(0), prec(0), scale(0), rctype(0), width(0) { }
+} ;
+
+struct Stmt ;
+
+struct Desc : Handle {
+	Stmt *st ;
+	Desc ( Stmt *s ) : Handle(SQL_HANDLE_DESC), st(s) { }
+} ;
+
+struct Stmt : Handle {
+	Dbc *dbc ;
+	std::string query ;
+	std::vector<Col> cols ;
+	std::vector<Bind> binds ;		// bound columns
+	std::vector<Bind> gets ;		// SQLGetData renderings
+	size_t nrows, next, cur, pos ;	// rows, next row to fetch, first row of the rowset, SQLSetPos row
+	bool open ;
+	SQLULEN array ;
+	SQLULEN *fetched ;
+	SQLULEN *offset ;
+	SQLULEN paramset ;
+	SQLULEN *processed ;
+	SQLUSMALLINT *pstatus ;
+	std::vector<size_t> gdoff ;		// SQLGetData offsets in the current row
+	Desc ard ;
+	bool dml ;						// statement without result set
+	bool async ;					// SQL_ATTR_ASYNC_ENABLE
+	bool running ;					// asynchronous execution in progress
+	bool canceled ;					// SQLCancel called during the execution
+	std::chrono::steady_clock::time_point started ;
+	Stmt ( Dbc *d ) : Handle(SQL_HANDLE_STMT), dbc(d), nrows(0), next(0), cur(0), pos(0), open(false),
+		array(1), fetched(0), offset(0), paramset(1), processed(0), pstatus(0), ard(this), dml(false), async(false), running(false),
+		canceled(false) { }
+} ;
+
+inline unsigned long long mix ( unsigned long long x ) {		// splitmix64
+	x += 0x9E3779B97F4A7C15ULL ;
+	x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL ;
+	x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL ;
+	return x ^ ( x >> 31 ) ;
+}
+
+long long pow10ll ( int n ) {
+	long long p = 1 ;
+	while ( n-- > 0 )
+		p *= 10 ;
+	return p ;
+}
+
+// Days from 1970-01-01 to y-m-d (proleptic Gregorian)
+void civil_from_days ( long long z, int &y, unsigned &m, unsigned &d ) {
+	z += 719468 ;
+	long long era = ( z >= 0 ? z : z - 146096 ) / 146097 ;
+	unsigned doe = (unsigned)( z - era * 146097 ) ;
+	unsigned yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365 ;
+	unsigned doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 ) ;
+	unsigned mp = ( 5 * doy + 2 ) / 153 ;
+	d = doy - ( 153 * mp + 2 ) / 5 + 1 ;
+	m = mp < 10 ? mp + 3 : mp - 9 ;
+	y = (int)( yoe + era * 400 + ( m <= 2 ) ) ;
+}
+
+bool wide_type ( SQLSMALLINT t ) { return t == SQL_WCHAR || t == SQL_WVARCHAR || t == SQL_WLONGVARCHAR ; }
+bool char_type ( SQLSMALLINT t ) { return t == SQL_CHAR || t == SQL_VARCHAR || t == SQL_LONGVARCHAR || wide_type(t) ; }
+bool binary_type ( SQLSMALLINT t ) { return t == SQL_BINARY || t == SQL_VARBINARY || t == SQL_LONGVARBINARY ; }
+
+// Generate the values of a column: "nv" distinct values and the NULL pattern
+void generate ( Col &c, size_t ci ) {
+	static const char *wide_chars[] = { "\xc3\xa9", "\xc3\xbc", "\xd0\x96", "\xe4\xb8\xad", "\xe6\x96\x87", "\xf0\x9f\x98\x80" } ;
+	size_t width = std::max((size_t)c.size, (size_t)8) ;
+	size_t nv = std::max((size_t)1, std::min((size_t)MOCK_VALUES, ( (size_t)MOCK_VALUES_MB << 20 ) / width)) ;
+	char buf[128] ;
+
+	for ( size_t v = 0 ; v < nv ; v++ ) {
+		unsigned long long h = mix(ci * 1000003ULL + v) ;
+		long long iv = 0 ;
+		double dv = 0 ;
+		std::string sv ;
+		switch ( c.sqlt ) {
+			case SQL_TINYINT:	iv = (long long)( h % 256 ) - 128 ; break ;
+			case SQL_SMALLINT:	iv = (long long)( h % 65536 ) - 32768 ; break ;
+			case SQL_INTEGER:	iv = (long long)(int)h ; break ;
+			case SQL_BIGINT:	iv = (long long)h >> ( h % 48 ) ; break ;
+			case SQL_BIT:		iv = (long long)( h & 1 ) ; break ;
+			case SQL_DOUBLE:	dv = (double)(long long)( h >> 11 ) / ( 1ULL << ( h % 40 ) ) ; break ;
+			case SQL_NUMERIC: {
+				int digits = 1 + (int)( h % (unsigned)std::min((int)c.size, 18) ) ;
+				iv = (long long)( mix(h) % (unsigned long long)pow10ll(digits) ) * ( h & 2 ? -1 : 1 ) ;
+				break ;
+			}
+			case SQL_TYPE_DATE:	iv = (long long)( h % 22000 ) ; break ;				// 1970-2030
+			case SQL_TYPE_TIME:	iv = (long long)( h % 86400 ) * 1000000 ; break ;
+			case SQL_TYPE_TIMESTAMP: iv = (long long)( h % ( 22000ULL * 86400000000ULL ) ) ; break ;
+			default: {		// strings and binaries: length in [size/2, size]
+				size_t len = c.size / 2 + (size_t)( h % ( c.size - c.size / 2 + 1 ) ) ;
+				for ( size_t i = 0 ; i < len ; ) {
+					unsigned long long r = mix(h + i) ;
+					if ( wide_type(c.sqlt) && r % 4 == 0 ) {		// a quarter of non ASCII characters
+						sv += wide_chars[r / 4 % 6] ;
+						i++ ;
+					} else if ( binary_type(c.sqlt) ) {
+						sv += (char)( r & 0xFF ) ;
+						i++ ;
+					} else {
+						sv += (char)( 'a' + r % 26 ) ;
+						i++ ;
+					}
+				}
+			}
+		}
+		if ( !char_type(c.sqlt) && !binary_type(c.sqlt) ) {		// text of non string values
+			int y ;
+			unsigned m, d ;
+			switch ( c.sqlt ) {
+				case SQL_DOUBLE:
+					snprintf(buf, sizeof(buf), "%.17g", dv) ;
+					break ;
+				case SQL_NUMERIC: {
+					long long p = pow10ll(c.scale), a = iv < 0 ? -iv : iv ;
+					std::string f = std::to_string(a % p + p) ;		// leading "1" followed by the decimals
+					snprintf(buf, sizeof(buf), "%s%lld%s%s", iv < 0 ? "-" : "", a / p, c.scale ? "." : "", f.c_str() + 1) ;
+					break ;
+				}
+				case SQL_TYPE_DATE:
+					civil_from_days(iv, y, m, d) ;
+					snprintf(buf, sizeof(buf), "%04d-%02u-%02u", y, m, d) ;
+					break ;
+				case SQL_TYPE_TIME:
+					snprintf(buf, sizeof(buf), "%02lld:%02lld:%02lld", iv / 3600000000LL, iv / 60000000LL % 60, iv / 1000000LL % 60) ;
+					break ;
+				case SQL_TYPE_TIMESTAMP:
+					civil_from_days(iv / 86400000000LL, y, m, d) ;
+					snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02lld:%02lld:%02lld.%06lld", y, m, d,
+						iv / 3600000000LL % 24, iv / 60000000LL % 60, iv / 1000000LL % 60, iv % 1000000LL) ;
+					break ;
+				default:
+					snprintf(buf, sizeof(buf), "%lld", iv) ;
+			}
+			sv = buf ;
+		}
+		c.iv.push_back(iv) ;
+		c.dv.push_back(dv) ;
+		c.sv.push_back(sv) ;
+	}
+	for ( size_t i = 0 ; i < MOCK_NULLS ; i++ )
+		c.null.push_back( (double)( mix(ci * 7919 + i) % 1000000 ) < c.nulls * 1000000 ) ;
+}
+
+// UTF-8 to SQLWCHAR (UTF-16, or UTF-32 where SQLWCHAR is 4 bytes)
+std::vector<SQLWCHAR> to_wide ( const std::string &s ) {
+	std::vector<SQLWCHAR> w ;
+	for ( size_t i = 0 ; i < s.size() ; ) {
+		unsigned char b = (unsigned char)s[i] ;
+		unsigned int cp, n = b < 0x80 ? 1 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : 4 ;
+		cp = n == 1 ? b : n == 2 ? b & 0x1F : n == 3 ? b & 0x0F : b & 0x07 ;
+		for ( unsigned int k = 1 ; k < n && i + k < s.size() ; k++ )
+			cp = cp << 6 | ( (unsigned char)s[i + k] & 0x3F ) ;
+		i += n ;
+		if ( cp >= 0x10000 && sizeof(SQLWCHAR) == 2 ) {
+			w.push_back((SQLWCHAR)( 0xD800 + ( ( cp - 0x10000 ) >> 10 ) )) ;
+			w.push_back((SQLWCHAR)( 0xDC00 + ( ( cp - 0x10000 ) & 0x3FF ) )) ;
+		} else {
+			w.push_back((SQLWCHAR)cp) ;
+		}
+	}
+	return w ;
+}
+
+// Render the values of column "c" in the C type of "b". Returns false for unsupported
+// conversions.
+bool render ( const Col &c, Bind &b ) {
+	size_t nv = c.sv.size() ;
+	SQLSMALLINT ct = b.ctype ;
+
+	switch ( ct ) {
+		case SQL_C_SBIGINT:	b.width = sizeof(SQLBIGINT) ; break ;
+		case SQL_C_DOUBLE:	b.width = sizeof(SQLDOUBLE) ; break ;
+		case SQL_C_BIT:		b.width = 1 ; break ;
+		case SQL_C_NUMERIC:	b.width = sizeof(SQL_NUMERIC_STRUCT) ; break ;
+		case SQL_C_DATE:
+		case SQL_C_TYPE_DATE:	b.width = sizeof(SQL_DATE_STRUCT) ; break ;
+		case SQL_C_TIME:
+		case SQL_C_TYPE_TIME:	b.width = sizeof(SQL_TIME_STRUCT) ; break ;
+		case SQL_C_TIMESTAMP:
+		case SQL_C_TYPE_TIMESTAMP:	b.width = sizeof(SQL_TIMESTAMP_STRUCT) ; break ;
+		case SQL_C_CHAR:
+		case SQL_C_BINARY: {
+			b.width = 1 ;
+			for ( size_t v = 0 ; v < nv ; v++ )
+				b.width = std::max(b.width, c.sv[v].size()) ;
+			break ;
+		}
+		case SQL_C_WCHAR: {
+			b.width = 1 ;
+			for ( size_t v = 0 ; v < nv ; v++ )
+				b.width = std::max(b.width, to_wide(c.sv[v]).size() * sizeof(SQLWCHAR)) ;
+			break ;
+		}
+		default:
+			return false ;
+	}
+	b.vals.assign(b.width * nv, 0) ;
+	b.lens.assign(nv, 0) ;
+	for ( size_t v = 0 ; v < nv ; v++ ) {
+		char *p = &b.vals[b.width * v] ;
+		long long iv = c.iv[v] ;
+		b.lens[v] = (SQLLEN)b.width ;
+		switch ( ct ) {
+			case SQL_C_SBIGINT: {
+				SQLBIGINT x = c.sqlt == SQL_NUMERIC ? iv / pow10ll(c.scale) : c.sqlt == SQL_DOUBLE ? (SQLBIGINT)c.dv[v] : iv ;
+				memcpy(p, &x, sizeof(x)) ;
+				break ;
+			}
+			case SQL_C_DOUBLE: {
+				SQLDOUBLE x = c.sqlt == SQL_DOUBLE ? c.dv[v] : c.sqlt == SQL_NUMERIC ? (double)iv / pow10ll(c.scale) : (double)iv ;
+				memcpy(p, &x, sizeof(x)) ;
+				break ;
+			}
+			case SQL_C_BIT:
+				*p = (char)( iv != 0 ) ;
+				break ;
+			case SQL_C_NUMERIC: {
+				SQL_NUMERIC_STRUCT ns ;
+				memset(&ns, 0, sizeof(ns)) ;
+				unsigned long long a = (unsigned long long)( iv < 0 ? -iv : iv ) ;
+				for ( int s = c.scale ; s < b.scale ; s++ )
+					a *= 10 ;
+				for ( int s = b.scale ; s < c.scale ; s++ )
+					a /= 10 ;
+				ns.precision = (SQLCHAR)b.prec ;
+				ns.scale = (SQLSCHAR)b.scale ;
+				ns.sign = iv < 0 ? 0 : 1 ;
+				for ( int k = 0 ; k < 8 ; k++ )
+					ns.val[k] = (SQLCHAR)( a >> ( 8 * k ) ) ;
+				memcpy(p, &ns, sizeof(ns)) ;
+				break ;
+			}
+			case SQL_C_DATE:
+			case SQL_C_TYPE_DATE: {
+				SQL_DATE_STRUCT ds ;
+				int y ;
+				unsigned m, d ;
+				civil_from_days(iv, y, m, d) ;
+				ds.year = (SQLSMALLINT)y ;
+				ds.month = (SQLUSMALLINT)m ;
+				ds.day = (SQLUSMALLINT)d ;
+				memcpy(p, &ds, sizeof(ds)) ;
+				break ;
+			}
+			case SQL_C_TIME:
+			case SQL_C_TYPE_TIME: {
+				SQL_TIME_STRUCT ts ;
+				ts.hour = (SQLUSMALLINT)( iv / 3600000000LL % 24 ) ;
+				ts.minute = (SQLUSMALLINT)( iv / 60000000LL % 60 ) ;
+				ts.second = (SQLUSMALLINT)( iv / 1000000LL % 60 ) ;
+				memcpy(p, &ts, sizeof(ts)) ;
+				break ;
+			}
+			case SQL_C_TIMESTAMP:
+			case SQL_C_TYPE_TIMESTAMP: {
+				SQL_TIMESTAMP_STRUCT ts ;
+				int y ;
+				unsigned m, d ;
+				civil_from_days(iv / 86400000000LL, y, m, d) ;
+				ts.year = (SQLSMALLINT)y ;
+				ts.month = (SQLUSMALLINT)m ;
+				ts.day = (SQLUSMALLINT)d ;
+				ts.hour = (SQLUSMALLINT)( iv / 3600000000LL % 24 ) ;
+				ts.minute = (SQLUSMALLINT)( iv / 60000000LL % 60 ) ;
+				ts.second = (SQLUSMALLINT)( iv / 1000000LL % 60 ) ;
+				ts.fraction = (SQLUINTEGER)( iv % 1000000LL * 1000 ) ;
+				memcpy(p, &ts, sizeof(ts)) ;
+				break ;
+			}
+			case SQL_C_CHAR:
+			case SQL_C_BINARY:
+				memcpy(p, c.sv[v].data(), c.sv[v].size()) ;
+				b.lens[v] = (SQLLEN)c.sv[v].size() ;
+				break ;
+			case SQL_C_WCHAR: {
+				std::vector<SQLWCHAR> w = to_wide(c.sv[v]) ;
+				if ( !w.empty() )
+					memcpy(p, w.data(), w.size() * sizeof(SQLWCHAR)) ;
+				b.lens[v] = (SQLLEN)( w.size() * sizeof(SQLWCHAR) ) ;
+				break ;
+			}
+		}
+	}
+	b.rctype = ct ;
+	return true ;
+}
+
+// Parse "SELECT <columns> FROM mock ROWS <n>", also wrapped as "SELECT * FROM (<query>) ..."
+// (split slices, watermark, chunks): the outer WHERE clause is ignored, except IS NULL (the
+// rows without chunk key), which returns no rows
+bool parse ( Stmt *st, const std::string &q ) {
+	std::string s = q ;
+	std::transform(s.begin(), s.end(), s.begin(), ::tolower) ;
+	if ( !s.compare(0, 15, "select * from (") && s.rfind(')') > 15 ) {
+		if ( !parse(st, q.substr(15, s.rfind(')') - 15)) )
+			return false ;
+		if ( s.find(" is null", s.rfind(')')) != std::string::npos )
+			st->nrows = 0 ;
+		return true ;
+	}
+	if ( s == "select 1 from dual" )		// type probe: one int row
+		return parse(st, "SELECT int FROM mock ROWS 1") ;
+	size_t from = s.find(" from ") ;
+	size_t rows = s.find(" rows ", from == std::string::npos ? 0 : from) ;
+	st->cols.clear() ;
+	st->dml = s.compare(0, 7, "select ") != 0 ;
+	if ( st->dml ) {
+		st->nrows = rows == std::string::npos ? 0 : strtoull(s.c_str() + rows + 6, NULL, 10) ;
+		return true ;
+	}
+	if ( from == std::string::npos )
+		return false ;
+	st->nrows = rows == std::string::npos ? 1000 : strtoull(s.c_str() + rows + 6, NULL, 10) ;
+
+	std::string list = s.substr(7, from - 7) ;
+	size_t i = 0 ;
+	while ( i < list.size() ) {
+		size_t e = i ;
+		int depth = 0 ;
+		while ( e < list.size() && ( list[e] != ',' || depth ) ) {
+			depth += list[e] == '(' ? 1 : list[e] == ')' ? -1 : 0 ;
+			e++ ;
+		}
+		std::string spec = list.substr(i, e - i) ;
+		i = e + 1 ;
+		spec.erase(std::remove(spec.begin(), spec.end(), ' '), spec.end()) ;
+		if ( spec.empty() )
+			continue ;
+
+		Col c ;
+		size_t tilde = spec.find('~') ;
+		c.nulls = tilde == std::string::npos ? 0 : atof(spec.c_str() + tilde + 1) ;
+		spec = spec.substr(0, tilde) ;
+		size_t par = spec.find('(') ;
+		std::string type = spec.substr(0, par) ;
+		long a = 0, b = 0 ;
+		if ( par != std::string::npos && sscanf(spec.c_str() + par, "(%ld,%ld)", &a, &b) < 1 )
+			return false ;
+		if ( b < 0 || b > 18 )		// numeric values have at most 18 digits
+			return false ;
+		static const struct { const char *name ; SQLSMALLINT sqlt ; long size ; } types[] = {
+			{ "tinyint", SQL_TINYINT, 3 }, { "smallint", SQL_SMALLINT, 5 }, { "int", SQL_INTEGER, 10 },
+			{ "bigint", SQL_BIGINT, 19 }, { "double", SQL_DOUBLE, 15 }, { "numeric", SQL_NUMERIC, 18 },
+			{ "char", SQL_CHAR, 1 }, { "varchar", SQL_VARCHAR, 32 }, { "wchar", SQL_WCHAR, 1 },
+			{ "wvarchar", SQL_WVARCHAR, 32 }, { "longvarchar", SQL_LONGVARCHAR, 1000000 },
+			{ "wlongvarchar", SQL_WLONGVARCHAR, 1000000 }, { "varbinary", SQL_VARBINARY, 32 }, { "date", SQL_TYPE_DATE, 10 }, { "time", SQL_TYPE_TIME, 8 },
+			{ "timestamp", SQL_TYPE_TIMESTAMP, 26 }, { "bit", SQL_BIT, 1 }
+		} ;
+		size_t t = 0 ;
+		while ( t < sizeof(types) / sizeof(types[0]) && type != types[t].name )
+			t++ ;
+		if ( t == sizeof(types) / sizeof(types[0]) )
+			return false ;
+		c.sqlt = types[t].sqlt ;
+		c.size = (SQLULEN)( a > 0 ? a : types[t].size ) ;
+		c.scale = (SQLSMALLINT)( c.sqlt == SQL_NUMERIC ? b : c.sqlt == SQL_TYPE_TIMESTAMP ? 6 : 0 ) ;
+		generate(c, st->cols.size()) ;
+		st->cols.push_back(c) ;
+	}
+	st->binds.assign(st->cols.size(), Bind()) ;
+	st->gets.assign(st->cols.size(), Bind()) ;
+	st->gdoff.assign(st->cols.size(), 0) ;
+	return !st->cols.empty() ;
+}
+
+SQLRETURN copy_string ( const std::string &s, SQLCHAR *out, SQLSMALLINT len, SQLSMALLINT *outl ) {
+	if ( outl )
+		*outl = (SQLSMALLINT)s.size() ;
+	if ( out && len > 0 ) {
+		size_t n = std::min(s.size(), (size_t)len - 1) ;
+		memcpy(out, s.data(), n) ;
+		out[n] = 0 ;
+	}
+	return SQL_SUCCESS ;
+}
+
+Stmt *stmt ( SQLHSTMT h ) { return static_cast<Stmt *>((Handle *)h) ; }
+
+SQLRETURN execute ( Stmt *st ) {
+	if ( st->cols.empty() && !st->dml )
+		return st->error("mock: no statement prepared") ;
+	if ( st->open && !st->running )
+		return st->error("mock: invalid cursor state (cursor open)", "24000") ;
+	if ( st->dbc->exec_ms && !st->async ) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(st->dbc->exec_ms)) ;
+	} else if ( st->dbc->exec_ms ) {
+		// Asynchronous: SQL_STILL_EXECUTING until EXEC_MS elapsed (or canceled)
+		if ( !st->running ) {
+			st->running = true ;
+			st->canceled = false ;
+			st->started = std::chrono::steady_clock::now() ;
+			return SQL_STILL_EXECUTING ;
+		}
+		if ( st->canceled ) {
+			st->running = false ;
+			return st->error("mock: operation canceled") ;
+		}
+		if ( std::chrono::steady_clock::now() - st->started < std::chrono::milliseconds(st->dbc->exec_ms) )
+			return SQL_STILL_EXECUTING ;
+		st->running = false ;
+	}
+	for ( size_t j = 0 ; j < st->binds.size() ; j++ )
+		st->binds[j].rctype = 0 ;
+	if ( st->dml && st->query.find("FAIL") != std::string::npos )
+		return st->error("mock: statement failed (FAIL)") ;
+	st->open = !st->dml ;
+	st->next = st->cur = st->pos = 0 ;
+	if ( st->processed )
+		*st->processed = st->paramset ;
+	if ( st->pstatus )
+		std::fill(st->pstatus, st->pstatus + st->paramset, (SQLUSMALLINT)SQL_PARAM_SUCCESS) ;
+	return SQL_SUCCESS ;
+}
+
+} // namespace
+
+extern "C" {
+
+SQLRETURN SQLAllocHandle ( SQLSMALLINT type, SQLHANDLE in, SQLHANDLE *out ) {
+	switch ( type ) {
+		case SQL_HANDLE_ENV:	*out = (SQLHANDLE)(Handle *)new Env() ; return SQL_SUCCESS ;
+		case SQL_HANDLE_DBC:	*out = (SQLHANDLE)(Handle *)new Dbc() ; return SQL_SUCCESS ;
+		case SQL_HANDLE_STMT:	*out = (SQLHANDLE)(Handle *)new Stmt(static_cast<Dbc *>((Handle *)in)) ; return SQL_SUCCESS ;
+	}
+	return SQL_ERROR ;
+}
+
+SQLRETURN SQLFreeHandle ( SQLSMALLINT, SQLHANDLE h ) {
+	delete (Handle *)h ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLSetEnvAttr ( SQLHENV, SQLINTEGER, SQLPOINTER, SQLINTEGER ) { return SQL_SUCCESS ; }
+
+SQLRETURN SQLDriverConnect ( SQLHDBC h, SQLHWND, SQLCHAR *cs, SQLSMALLINT, SQLCHAR *, SQLSMALLINT, SQLSMALLINT *, SQLUSMALLINT ) {
+	Dbc *dbc = static_cast<Dbc *>((Handle *)h) ;
+	std::string s = (const char *)cs, tok ;
+	size_t i = 0 ;
+	while ( i <= s.size() ) {
+		size_t e = s.find(';', i) ;
+		tok = s.substr(i, e == std::string::npos ? std::string::npos : e - i) ;
+		i = e == std::string::npos ? s.size() + 1 : e + 1 ;
+		size_t eq = tok.find('=') ;
+		if ( eq == std::string::npos )
+			continue ;
+		std::string k = tok.substr(0, eq), v = tok.substr(eq + 1) ;
+		std::transform(k.begin(), k.end(), k.begin(), ::toupper) ;
+		if ( k == "DBMS" )
+			dbc->dbms = v ;
+		else if ( k == "NOBIGINT" )
+			dbc->nobigint = atoi(v.c_str()) != 0 ;
+		else if ( k == "LATENCY_US" )
+			dbc->latency = atol(v.c_str()) ;
+		else if ( k == "EXEC_MS" )
+			dbc->exec_ms = atol(v.c_str()) ;
+		else if ( k == "ASYNC" )
+			dbc->async = atoi(v.c_str()) != 0 ;
+	}
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLDisconnect ( SQLHDBC ) { return SQL_SUCCESS ; }
+SQLRETURN SQLEndTran ( SQLSMALLINT, SQLHANDLE, SQLSMALLINT ) { return SQL_SUCCESS ; }
+SQLRETURN SQLSetConnectAttr ( SQLHDBC, SQLINTEGER, SQLPOINTER, SQLINTEGER ) { return SQL_SUCCESS ; }
+SQLRETURN SQLCancel ( SQLHSTMT h ) {
+	Stmt *st = stmt(h) ;
+	st->canceled = st->running ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLGetConnectAttr ( SQLHDBC, SQLINTEGER attr, SQLPOINTER val, SQLINTEGER, SQLINTEGER * ) {
+	if ( attr == SQL_ATTR_CONNECTION_DEAD ) {
+		*(SQLUINTEGER *)val = SQL_CD_FALSE ;
+		return SQL_SUCCESS ;
+	}
+	return SQL_ERROR ;
+}
+
+SQLRETURN SQLGetDiagRec ( SQLSMALLINT, SQLHANDLE h, SQLSMALLINT rec, SQLCHAR *state, SQLINTEGER *native,
+		SQLCHAR *text, SQLSMALLINT len, SQLSMALLINT *outl ) {
+	Handle *hd = (Handle *)h ;
+	if ( !hd || rec != 1 || hd->diag.empty() )
+		return SQL_NO_DATA ;
+	if ( state )
+		memcpy(state, hd->state.c_str(), 6) ;
+	if ( native )
+		*native = 0 ;
+	return copy_string(hd->diag, text, len, outl) ;
+}
+
+SQLRETURN SQLGetInfo ( SQLHDBC h, SQLUSMALLINT type, SQLPOINTER val, SQLSMALLINT len, SQLSMALLINT *outl ) {
+	Dbc *dbc = static_cast<Dbc *>((Handle *)h) ;
+	switch ( type ) {
+		case SQL_DBMS_NAME:
+			return copy_string(dbc->dbms, (SQLCHAR *)val, len, outl) ;
+		case SQL_GETDATA_EXTENSIONS:
+			*(SQLUINTEGER *)val = SQL_GD_ANY_COLUMN | SQL_GD_ANY_ORDER | SQL_GD_BLOCK | SQL_GD_BOUND ;
+			return SQL_SUCCESS ;
+		case SQL_ASYNC_MODE:
+			*(SQLUINTEGER *)val = dbc->async ? SQL_AM_STATEMENT : SQL_AM_NONE ;
+			return SQL_SUCCESS ;
+	}
+	return dbc->error("mock: unsupported SQLGetInfo type") ;
+}
+
+SQLRETURN SQLPrepare ( SQLHSTMT h, SQLCHAR *q, SQLINTEGER ) {
+	Stmt *st = stmt(h) ;
+	if ( st->open )
+		return st->error("mock: invalid cursor state (cursor open)", "24000") ;
+	st->query = (const char *)q ;
+	if ( !parse(st, st->query) )
+		return st->error("mock: cannot parse <" + st->query + ">") ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLExecute ( SQLHSTMT h ) { return execute(stmt(h)) ; }
+
+SQLRETURN SQLExecDirect ( SQLHSTMT h, SQLCHAR *q, SQLINTEGER l ) {
+	if ( stmt(h)->running )		// polled asynchronous execution
+		return execute(stmt(h)) ;
+	SQLRETURN r = SQLPrepare(h, q, l) ;
+	return SQL_SUCCEEDED(r) ? execute(stmt(h)) : r ;
+}
+
+SQLRETURN SQLNumResultCols ( SQLHSTMT h, SQLSMALLINT *n ) {
+	*n = (SQLSMALLINT)stmt(h)->cols.size() ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLRowCount ( SQLHSTMT h, SQLLEN *n ) {
+	*n = stmt(h)->dml ? (SQLLEN)stmt(h)->nrows : -1 ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLNumParams ( SQLHSTMT h, SQLSMALLINT *n ) {
+	*n = (SQLSMALLINT)std::count(stmt(h)->query.begin(), stmt(h)->query.end(), '?') ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLBindParameter ( SQLHSTMT, SQLUSMALLINT, SQLSMALLINT, SQLSMALLINT, SQLSMALLINT, SQLULEN, SQLSMALLINT,
+		SQLPOINTER, SQLLEN, SQLLEN * ) {
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLDescribeCol ( SQLHSTMT h, SQLUSMALLINT c, SQLCHAR *name, SQLSMALLINT len, SQLSMALLINT *namel,
+		SQLSMALLINT *type, SQLULEN *size, SQLSMALLINT *scale, SQLSMALLINT *nullable ) {
+	Stmt *st = stmt(h) ;
+	if ( c < 1 || c > st->cols.size() )
+		return st->error("mock: invalid column number") ;
+	const Col &col = st->cols[c - 1] ;
+	copy_string("c" + std::to_string((long long)c), name, len, namel) ;
+	*type = col.sqlt ;
+	*size = col.size ;
+	*scale = col.scale ;
+	*nullable = 1 ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLColAttribute ( SQLHSTMT h, SQLUSMALLINT c, SQLUSMALLINT field, SQLPOINTER, SQLSMALLINT, SQLSMALLINT *, SQLLEN *num ) {
+	Stmt *st = stmt(h) ;
+	if ( c < 1 || c > st->cols.size() || field != SQL_DESC_OCTET_LENGTH )
+		return st->error("mock: unsupported SQLColAttribute") ;
+	const Col &col = st->cols[c - 1] ;
+	*num = (SQLLEN)( wide_type(col.sqlt) ? col.size * 4 : col.size ) ;		// UTF-8 room, like many drivers
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLBindCol ( SQLHSTMT h, SQLUSMALLINT c, SQLSMALLINT ctype, SQLPOINTER data, SQLLEN len, SQLLEN *ind ) {
+	Stmt *st = stmt(h) ;
+	if ( c < 1 || c > st->binds.size() )		// deferred: no result set yet
+		return st->cols.empty() ? SQL_SUCCESS : st->error("mock: invalid column number") ;
+	Bind &b = st->binds[c - 1] ;
+	b.ctype = ctype ;
+	b.data = data ;
+	b.len = len ;
+	b.ind = ind ;
+	b.rctype = 0 ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLFreeStmt ( SQLHSTMT h, SQLUSMALLINT opt ) {
+	Stmt *st = stmt(h) ;
+	if ( opt == SQL_CLOSE )
+		st->open = false ;
+	else if ( opt == SQL_UNBIND )
+		st->binds.assign(st->cols.size(), Bind()) ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLSetStmtAttr ( SQLHSTMT h, SQLINTEGER attr, SQLPOINTER val, SQLINTEGER ) {
+	Stmt *st = stmt(h) ;
+	switch ( attr ) {
+		case SQL_ATTR_ROW_ARRAY_SIZE:		st->array = (SQLULEN)val ; break ;
+		case SQL_ATTR_ROWS_FETCHED_PTR:		st->fetched = (SQLULEN *)val ; break ;
+		case SQL_ATTR_ROW_BIND_OFFSET_PTR:	st->offset = (SQLULEN *)val ; break ;
+		case SQL_ATTR_PARAMSET_SIZE:		st->paramset = (SQLULEN)val ; break ;
+		case SQL_ATTR_PARAMS_PROCESSED_PTR:	st->processed = (SQLULEN *)val ; break ;
+		case SQL_ATTR_PARAM_STATUS_PTR:		st->pstatus = (SQLUSMALLINT *)val ; break ;
+		case SQL_ATTR_ASYNC_ENABLE:
+			if ( (SQLULEN)val == SQL_ASYNC_ENABLE_ON && !st->dbc->async )
+				return st->error("mock: asynchronous execution not supported (ASYNC)") ;
+			st->async = (SQLULEN)val == SQL_ASYNC_ENABLE_ON ;
+			break ;
+		case SQL_ATTR_ROW_BIND_TYPE:
+			if ( (SQLULEN)val != SQL_BIND_BY_COLUMN )
+				return st->error("mock: only column-wise binding") ;
+			break ;
+	}
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLGetStmtAttr ( SQLHSTMT h, SQLINTEGER attr, SQLPOINTER val, SQLINTEGER, SQLINTEGER * ) {
+	Stmt *st = stmt(h) ;
+	if ( attr != SQL_ATTR_APP_ROW_DESC )
+		return st->error("mock: unsupported SQLGetStmtAttr") ;
+	*(SQLHDESC *)val = (SQLHDESC)(Handle *)&st->ard ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLSetDescField ( SQLHDESC h, SQLSMALLINT rec, SQLSMALLINT field, SQLPOINTER val, SQLINTEGER ) {
+	Stmt *st = static_cast<Desc *>((Handle *)h)->st ;
+	if ( rec < 1 || (size_t)rec > st->binds.size() )
+		return st->error("mock: invalid descriptor record") ;
+	Bind &b = st->binds[rec - 1] ;
+	switch ( field ) {
+		case SQL_DESC_TYPE:			b.ctype = (SQLSMALLINT)(SQLLEN)val ; b.data = 0 ; break ;
+		case SQL_DESC_PRECISION:	b.prec = (SQLSMALLINT)(SQLLEN)val ; b.data = 0 ; break ;
+		case SQL_DESC_SCALE:		b.scale = (SQLSMALLINT)(SQLLEN)val ; b.data = 0 ; break ;
+		case SQL_DESC_DATA_PTR:		b.data = val ; break ;
+	}
+	b.rctype = 0 ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLFetchScroll ( SQLHSTMT h, SQLSMALLINT, SQLLEN ) {
+	Stmt *st = stmt(h) ;
+	if ( !st->open )
+		return st->error("mock: cursor not open") ;
+	if ( st->dbc->latency )
+		std::this_thread::sleep_for(std::chrono::microseconds(st->dbc->latency)) ;
+	size_t n = std::min((size_t)st->array, st->nrows - st->next) ;
+	if ( st->fetched )
+		*st->fetched = n ;
+	if ( !n )
+		return SQL_NO_DATA ;
+	st->cur = st->pos = st->next ;
+	st->next += n ;
+	std::fill(st->gdoff.begin(), st->gdoff.end(), 0) ;
+	SQLULEN off = st->offset ? *st->offset : 0 ;
+
+	for ( size_t j = 0 ; j < st->binds.size() ; j++ ) {
+		Bind &b = st->binds[j] ;
+		const Col &c = st->cols[j] ;
+		if ( !b.data )
+			continue ;
+		if ( b.ctype == SQL_C_SBIGINT && st->dbc->nobigint )
+			return st->error("mock: restricted data type attribute violation (NOBIGINT)", "07006") ;
+		if ( b.rctype != b.ctype && !render(c, b) )
+			return st->error("mock: unsupported conversion") ;
+		bool var = b.ctype == SQL_C_CHAR || b.ctype == SQL_C_BINARY || b.ctype == SQL_C_WCHAR ;
+		size_t term = b.ctype == SQL_C_CHAR ? 1 : b.ctype == SQL_C_WCHAR ? sizeof(SQLWCHAR) : 0 ;
+		size_t stride = var ? (size_t)b.len : b.width ;
+		char *data = (char *)b.data + off ;
+		SQLLEN *ind = (SQLLEN *)((char *)b.ind + off) ;
+		size_t nv = c.sv.size() ;
+		for ( size_t r = 0 ; r < n ; r++ ) {
+			size_t row = st->cur + r ;
+			if ( c.null[row % MOCK_NULLS] ) {
+				ind[r] = SQL_NULL_DATA ;
+				continue ;
+			}
+			size_t v = row % nv ;
+			SQLLEN l = b.lens[v] ;
+			char *p = data + stride * r ;
+			if ( var ) {
+				size_t m = std::min((size_t)l, stride - term) ;
+				memcpy(p, &b.vals[b.width * v], m) ;
+				memset(p + m, 0, term) ;
+			} else {
+				memcpy(p, &b.vals[b.width * v], b.width) ;
+			}
+			ind[r] = l ;
+		}
+	}
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLFetch ( SQLHSTMT h ) { return SQLFetchScroll(h, SQL_FETCH_NEXT, 0) ; }
+
+SQLRETURN SQLSetPos ( SQLHSTMT h, SQLSETPOSIROW row, SQLUSMALLINT, SQLUSMALLINT ) {
+	Stmt *st = stmt(h) ;
+	if ( row < 1 || st->cur + row > st->next )
+		return st->error("mock: row out of rowset") ;
+	st->pos = st->cur + row - 1 ;
+	std::fill(st->gdoff.begin(), st->gdoff.end(), 0) ;
+	return SQL_SUCCESS ;
+}
+
+SQLRETURN SQLGetData ( SQLHSTMT h, SQLUSMALLINT c, SQLSMALLINT ctype, SQLPOINTER data, SQLLEN len, SQLLEN *ind ) {
+	Stmt *st = stmt(h) ;
+	if ( c < 1 || c > st->cols.size() )
+		return st->error("mock: invalid column number") ;
+	const Col &col = st->cols[c - 1] ;
+	Bind &b = st->gets[c - 1] ;
+	size_t &off = st->gdoff[c - 1] ;
+	if ( col.null[st->pos % MOCK_NULLS] ) {
+		*ind = SQL_NULL_DATA ;
+		return SQL_SUCCESS ;
+	}
+	b.ctype = ctype ;
+	if ( b.rctype != ctype && !render(col, b) )
+		return st->error("mock: unsupported conversion") ;
+	size_t v = st->pos % col.sv.size() ;
+	size_t l = (size_t)b.lens[v] ;
+	if ( off && off >= l )
+		return SQL_NO_DATA ;
+	size_t term = ctype == SQL_C_CHAR ? 1 : ctype == SQL_C_WCHAR ? sizeof(SQLWCHAR) : 0 ;
+	size_t room = (size_t)len > term ? (size_t)len - term : 0 ;
+	size_t m = std::min(l - off, room) ;
+	memcpy(data, &b.vals[b.width * v + off], m) ;
+	memset((char *)data + m, 0, term) ;
+	*ind = (SQLLEN)( l - off ) ;
+	off += m ;
+	if ( !m )
+		off = l ;		// empty value: next call gets SQL_NO_DATA
+	return off < l ? SQL_SUCCESS_WITH_INFO : SQL_SUCCESS ;
+}
+
+} // extern "C"
@@ -0,0 +1,39 @@
+// (c) Copyright [2022-2023] Micro Focus or one of its affiliates.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Stand-in of the SDK StringParsers helper (benchmark only): NUMERIC strings DBLink does not
+// parse itself (exponents...) go through strtold, like a slow generic parser would.
+
+#pragma once
+#include "Vertica.h"
+
+class StringParsers
+{
+public:
+	bool parseNumeric ( char *s, size_t len, size_t, Vertica::VNumeric &vn, const Vertica::VerticaType &t, std::string & ) {
+		std::string v(s, len) ;
+		char *end = NULL ;
+		long double d = strtold(v.c_str(), &end) ;
+		if ( end == v.c_str() )
+			return false ;
+		for ( int i = 0 ; i < t.getNumericScale() ; i++ )
+			d *= 10 ;
+		__int128 x = (__int128)( d < 0 ? d - 0.5L : d + 0.5L ) ;
+		vn.words[vn.nwds - 1] = (Vertica::uint64)x ;
+		if ( vn.nwds > 1 )
+			vn.words[vn.nwds - 2] = (Vertica::uint64)( x >> 64 ) ;
+		for ( int w = 0 ; w < vn.nwds - 2 ; w++ )
+			vn.words[w] = x < 0 ? ~(Vertica::uint64)0 : 0 ;
+		return true ;
+	}
+} ;
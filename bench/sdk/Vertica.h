@@ -0,0 +1,464 @@
+// (c) Copyright [2022-2023] Micro Focus or one of its affiliates.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Minimal stand-in of the Vertica C++ SDK, only what ldblink.cpp uses, so the benchmark can
+// run DBLink outside Vertica. Values written through PartitionWriter are stored in one slot
+// per column (overwritten by each row) and counted: enough to measure the conversion cost.
+
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+#include <ctime>
+#include <stdexcept>
+#include <algorithm>
+#include <sstream>
+#include <stdint.h>
+
+namespace Vertica {
+
+typedef int64_t vint ;
+typedef int64_t int64 ;
+typedef uint64_t uint64 ;
+typedef int32_t int32 ;
+typedef uint32_t uint32 ;
+typedef uint8_t uint8 ;
+typedef int16_t int16 ;
+typedef uint16_t uint16 ;
+typedef double vfloat ;
+typedef uint32_t vsize ;
+typedef int64_t DateADT ;
+typedef int64_t TimeADT ;
+typedef int64_t Timestamp ;
+typedef int64_t TimestampTz ;
+typedef int64_t Interval ;
+typedef int64_t IntervalYM ;
+typedef uint8_t vbool ;
+
+const vbool VFalse = 0 ;
+const vbool VTrue = 1 ;
+const vbool vbool_null = 2 ;
+const vint vint_null = INT64_MIN ;
+const int64 usPerSecond = 1000000LL ;
+const int64 usPerMinute = 60 * usPerSecond ;
+const int64 usPerHour = 60 * usPerMinute ;
+const int64 usPerDay = 24 * usPerHour ;
+const int MONTHS_PER_YEAR = 12 ;
+const int32 INTERVAL_YEAR2MONTH = 0 ;
+const int32 INTERVAL_DAY2SECOND = 0 ;
+
+inline TimeADT getTimeFromUnixTime ( time_t t ) { return (TimeADT)( t % 86400 ) * usPerSecond ; }
+
+// Column types:
+class VerticaType
+{
+public:
+	enum Base { T_INT, T_FLOAT, T_BOOL, T_NUMERIC, T_CHAR, T_VARCHAR, T_LONGVARCHAR, T_BINARY,
+		T_VARBINARY, T_LONGVARBINARY, T_DATE, T_TIME, T_TIMESTAMP, T_TIMESTAMPTZ, T_INTERVAL,
+		T_INTERVALYM, T_ANY } ;
+
+	VerticaType ( Base b = T_ANY, int32 len = 0, int32 prec = 0, int32 scale = 0 )
+		: base(b), len(len), prec(prec), scale(scale) { }
+
+	bool isInt () const { return base == T_INT ; }
+	bool isFloat () const { return base == T_FLOAT ; }
+	bool isBool () const { return base == T_BOOL ; }
+	bool isNumeric () const { return base == T_NUMERIC ; }
+	bool isChar () const { return base == T_CHAR ; }
+	bool isVarchar () const { return base == T_VARCHAR ; }
+	bool isLongVarchar () const { return base == T_LONGVARCHAR ; }
+	bool isBinary () const { return base == T_BINARY ; }
+	bool isVarbinary () const { return base == T_VARBINARY ; }
+	bool isLongVarbinary () const { return base == T_LONGVARBINARY ; }
+	bool isStringType () const { return base >= T_CHAR && base <= T_LONGVARBINARY ; }
+	bool isDate () const { return base == T_DATE ; }
+	bool isTime () const { return base == T_TIME ; }
+	bool isTimestamp () const { return base == T_TIMESTAMP ; }
+	bool isTimestampTz () const { return base == T_TIMESTAMPTZ ; }
+	bool isInterval () const { return base == T_INTERVAL ; }
+	bool isIntervalYM () const { return base == T_INTERVALYM ; }
+	int32 getStringLength ( bool = false ) const { return len ; }
+	int32 getNumericPrecision () const { return prec ; }
+	int32 getNumericScale () const { return scale ; }
+	int32 getNumericWords () const { return prec / 19 + 1 ; }
+	std::string getTypeStr () const {
+		static const char *names[] = { "Integer", "Float", "Boolean", "Numeric", "Char", "Varchar",
+			"Long Varchar", "Binary", "Varbinary", "Long Varbinary", "Date", "Time", "Timestamp",
+			"TimestampTz", "Interval", "Interval Year to Month", "Any" } ;
+		return names[base] ;
+	}
+
+	Base base ;
+	int32 len, prec, scale ;
+} ;
+
+class SizedColumnTypes
+{
+public:
+	struct Properties {
+		bool visible, required, canBeNull ;
+		std::string comment ;
+	} ;
+
+	void addInt ( const std::string &n = "" ) { add(VerticaType(VerticaType::T_INT, 8), n) ; }
+	void addInt ( const std::string &n, const Properties & ) { addInt(n) ; }
+	void addFloat ( const std::string &n = "" ) { add(VerticaType(VerticaType::T_FLOAT, 8), n) ; }
+	void addFloat ( const std::string &n, const Properties & ) { addFloat(n) ; }
+	void addBool ( const std::string &n = "" ) { add(VerticaType(VerticaType::T_BOOL, 1), n) ; }
+	void addBool ( const std::string &n, const Properties & ) { addBool(n) ; }
+	void addNumeric ( int32 p, int32 s, const std::string &n = "" ) { add(VerticaType(VerticaType::T_NUMERIC, 0, p, s), n) ; }
+	void addChar ( int32 l, const std::string &n = "" ) { add(VerticaType(VerticaType::T_CHAR, l), n) ; }
+	void addVarchar ( int32 l, const std::string &n = "" ) { add(VerticaType(VerticaType::T_VARCHAR, l), n) ; }
+	void addVarchar ( int32 l, const std::string &n, const Properties & ) { addVarchar(l, n) ; }
+	void addLongVarchar ( int32 l, const std::string &n = "" ) { add(VerticaType(VerticaType::T_LONGVARCHAR, l), n) ; }
+	void addLongVarchar ( int32 l, const std::string &n, const Properties & ) { addLongVarchar(l, n) ; }
+	void addBinary ( int32 l, const std::string &n = "" ) { add(VerticaType(VerticaType::T_BINARY, l), n) ; }
+	void addVarbinary ( int32 l, const std::string &n = "" ) { add(VerticaType(VerticaType::T_VARBINARY, l), n) ; }
+	void addLongVarbinary ( int32 l, const std::string &n = "" ) { add(VerticaType(VerticaType::T_LONGVARBINARY, l), n) ; }
+	void addDate ( const std::string &n = "" ) { add(VerticaType(VerticaType::T_DATE, 8), n) ; }
+	void addTime ( int32 p, const std::string &n = "" ) { add(VerticaType(VerticaType::T_TIME, 8, p), n) ; }
+	void addTimestamp ( int32 p, const std::string &n = "" ) { add(VerticaType(VerticaType::T_TIMESTAMP, 8, p), n) ; }
+	void addTimestampTz ( int32 p, const std::string &n = "" ) { add(VerticaType(VerticaType::T_TIMESTAMPTZ, 8, p), n) ; }
+	void addInterval ( int32 p, int32, const std::string &n = "" ) { add(VerticaType(VerticaType::T_INTERVAL, 8, p), n) ; }
+	void addIntervalYM ( int32, const std::string &n = "" ) { add(VerticaType(VerticaType::T_INTERVALYM, 8), n) ; }
+
+	size_t getColumnCount () const { return types.size() ; }
+	const VerticaType &getColumnType ( size_t i ) const { return types.at(i) ; }
+	const std::string &getColumnName ( size_t i ) const { return names.at(i) ; }
+
+private:
+	void add ( const VerticaType &t, const std::string &n ) {
+		types.push_back(t) ;
+		names.push_back(n) ;
+	}
+	std::vector<VerticaType> types ;
+	std::vector<std::string> names ;
+} ;
+
+class ColumnTypes
+{
+public:
+	void addAny () { }
+} ;
+
+// Values:
+class VString
+{
+public:
+	VString () : null(false) { }
+	VString ( const std::string &s ) : buf(s), null(false) { }
+	const char *data () const { return buf.data() ; }
+	char *data () { return &buf[0] ; }
+	vsize length () const { return (vsize)buf.size() ; }
+	bool isNull () const { return null ; }
+	void setNull () { null = true ; buf.clear() ; }
+	void alloc ( vsize len ) { null = false ; buf.resize(len) ; }
+	void copy ( const char *s, vsize len ) { null = false ; buf.assign(s, len) ; }
+	void copy ( const std::string &s ) { copy(s.data(), (vsize)s.size()) ; }
+	void copy ( const VString *v ) { copy(v->buf) ; }
+	std::string str () const { return buf ; }
+
+private:
+	std::string buf ;
+	bool null ;
+} ;
+
+class VNumeric
+{
+public:
+	VNumeric ( uint64 *words, int32 prec, int32 scale ) : words(words), nwds(prec / 19 + 1), scale(scale) { }
+	bool isNull () const { return words[0] == 0x8000000000000000ULL && std::all_of(words + 1, words + nwds, [](uint64 w){ return !w ; }) ; }
+	void setNull () { setZero() ; words[0] = 0x8000000000000000ULL ; }
+	void setZero () { memset(words, 0, nwds * sizeof(uint64)) ; }
+	// Decimal rendering of the low 128 bits (the benchmark never goes beyond 38 digits)
+	bool toString ( char *out, int len ) const {
+		unsigned __int128 v = (unsigned __int128)words[nwds - 1] | ( nwds > 1 ? (unsigned __int128)words[nwds - 2] << 64 : 0 ) ;
+		bool neg = (int64)words[0] < 0 ;
+		char d[64] ;
+		int n = 0 ;
+		if ( neg )
+			v = nwds > 1 ? ~v + 1 : (unsigned __int128)(uint64)( 0 - words[0] ) ;
+		do {
+			d[n++] = (char)( '0' + (int)( v % 10 ) ) ;
+			v /= 10 ;
+		} while ( v || n <= scale ) ;
+		std::string s = neg ? "-" : "" ;
+		for ( int i = n ; i-- > 0 ; ) {
+			s += d[i] ;
+			if ( i == scale && scale )
+				s += '.' ;
+		}
+		if ( (int)s.size() >= len )
+			return false ;
+		strcpy(out, s.c_str()) ;
+		return true ;
+	}
+
+	uint64 *words ;
+	int nwds ;
+	int scale ;
+} ;
+
+// Parameters:
+class ParamReader
+{
+public:
+	bool containsParameter ( const std::string &n ) const { return strs.count(n) || ints.count(n) || bools.count(n) ; }
+	const VString &getStringRef ( const std::string &n ) const { return get(strs, n) ; }
+	const vint &getIntRef ( const std::string &n ) const { return get(ints, n) ; }
+	const vbool &getBoolRef ( const std::string &n ) const { return get(bools, n) ; }
+
+	void setString ( const std::string &n, const std::string &v ) { strs[n] = VString(v) ; }
+	void setInt ( const std::string &n, vint v ) { ints[n] = v ; }
+	void setBool ( const std::string &n, bool v ) { bools[n] = v ? VTrue : VFalse ; }
+
+private:
+	template <class T>
+	static const T &get ( const std::map<std::string, T> &m, const std::string &n ) {
+		typename std::map<std::string, T>::const_iterator it = m.find(n) ;
+		if ( it == m.end() )
+			throw std::runtime_error("parameter " + n + " has the wrong type") ;
+		return it->second ;
+	}
+	std::map<std::string, VString> strs ;
+	std::map<std::string, vint> ints ;
+	std::map<std::string, vbool> bools ;
+
+	friend class ParamWriter ;
+} ;
+
+class ParamWriter : public ParamReader
+{
+public:
+	VString &getStringRef ( const std::string &n ) { return strs[n] ; }
+} ;
+
+// Allocator: memory lives until the ServerInterface goes away (like a query)
+class VTAllocator
+{
+public:
+	VTAllocator () : bytes(0) { }
+	~VTAllocator () {
+		for ( size_t i = 0 ; i < blocks.size() ; i++ )
+			free(blocks[i]) ;
+	}
+	void *alloc ( size_t n ) {
+		void *p = calloc(1, std::max(n, (size_t)1)) ;
+		if ( !p )
+			throw std::bad_alloc() ;
+		blocks.push_back(p) ;
+		bytes += n ;
+		return p ;
+	}
+	size_t bytes ;		// Allocated so far
+
+private:
+	std::vector<void *> blocks ;
+} ;
+
+class ServerInterface
+{
+public:
+	ServerInterface () : allocator(&arena), verbose(false) { }
+	ParamReader getParamReader () { return params ; }
+	ParamReader getUDSessionParamReader ( const std::string & ) { return sparams ; }
+	std::string getCurrentNodeName () { return "bench" ; }
+	void log ( const char *fmt, ... ) {
+		if ( !verbose )
+			return ;
+		va_list ap ;
+		va_start(ap, fmt) ;
+		vfprintf(stderr, fmt, ap) ;
+		va_end(ap) ;
+		fputc('\n', stderr) ;
+	}
+
+	ParamReader params ;
+	ParamReader sparams ;
+	VTAllocator arena ;
+	VTAllocator *allocator ;
+	bool verbose ;
+} ;
+
+// Input/output rows:
+class PartitionReader
+{
+public:
+	size_t getNumCols () { return types.getColumnCount() ; }
+	const SizedColumnTypes &getTypeMetaData () { return types ; }
+	bool isNull ( size_t ) { return true ; }
+	bool next () { return false ; }
+	const vint &getIntRef ( size_t ) { return zero ; }
+	const vfloat &getFloatRef ( size_t ) { return fzero ; }
+	const vbool &getBoolRef ( size_t ) { return bzero ; }
+	const VString &getStringRef ( size_t ) { return szero ; }
+	const VNumeric &getNumericRef ( size_t ) { throw std::runtime_error("no input numerics") ; }
+	const DateADT &getDateRef ( size_t ) { return zero ; }
+	const TimeADT &getTimeRef ( size_t ) { return zero ; }
+	const Timestamp &getTimestampRef ( size_t ) { return zero ; }
+	const TimestampTz &getTimestampTzRef ( size_t ) { return zero ; }
+	const Interval &getIntervalRef ( size_t ) { return zero ; }
+	const IntervalYM &getIntervalYMRef ( size_t ) { return zero ; }
+
+	SizedColumnTypes types ;
+
+private:
+	vint zero = 0 ;
+	vfloat fzero = 0 ;
+	vbool bzero = VFalse ;
+	VString szero ;
+} ;
+
+class PartitionWriter
+{
+public:
+	PartitionWriter ( const SizedColumnTypes &types ) : types(types), rows(0), nulls(0), bytes(0), sums(types.getColumnCount(), 0) {
+		for ( size_t j = 0 ; j < types.getColumnCount() ; j++ ) {
+			const VerticaType &t = types.getColumnType(j) ;
+			strs.push_back(VString()) ;
+			words.push_back(std::vector<uint64>(t.isNumeric() ? t.getNumericWords() : 1)) ;
+			nums.push_back(VNumeric(words.back().data(), t.getNumericPrecision(), t.getNumericScale())) ;
+		}
+		for ( size_t j = 0 ; j < nums.size() ; j++ )
+			nums[j].words = words[j].data() ;
+	}
+
+	const SizedColumnTypes &getTypeMetaData () { return types ; }
+	void setNull ( size_t ) { nulls++ ; }
+	void setInt ( size_t j, vint v ) { put(j, (uint64)v, 8) ; }
+	void setFloat ( size_t j, vfloat v ) { uint64 u ; memcpy(&u, &v, 8) ; put(j, u, 8) ; }
+	void setBool ( size_t j, vbool v ) { put(j, v, 1) ; }
+	void setDate ( size_t j, DateADT v ) { put(j, (uint64)v, 8) ; }
+	void setTime ( size_t j, TimeADT v ) { put(j, (uint64)v, 8) ; }
+	void setTimestamp ( size_t j, Timestamp v ) { put(j, (uint64)v, 8) ; }
+	void setTimestampTz ( size_t j, TimestampTz v ) { put(j, (uint64)v, 8) ; }
+	void setInterval ( size_t j, Interval v ) { put(j, (uint64)v, 8) ; }
+	VString &getStringRef ( size_t j ) { return strs[j] ; }
+	VNumeric &getNumericRef ( size_t j ) { return nums[j] ; }
+	// End of row: account the values left in the string and numeric slots
+	bool next () {
+		for ( size_t j = 0 ; j < strs.size() ; j++ ) {
+			if ( types.getColumnType(j).isNumeric() ) {
+				put(j, words[j].back(), 8 * words[j].size()) ;
+				words[j].back() = 0 ;
+			} else if ( strs[j].length() ) {
+				put(j, (uint64)(unsigned char)strs[j].data()[0] + strs[j].length(), strs[j].length()) ;
+				strs[j].alloc(0) ;
+			}
+		}
+		rows++ ;
+		return true ;
+	}
+
+	const SizedColumnTypes &types ;
+	size_t rows ;					// Rows written
+	size_t nulls ;					// NULL values written
+	size_t bytes ;					// Bytes of the non NULL values
+	std::vector<uint64> sums ;		// Per column checksum (keeps the compiler from skipping work)
+
+private:
+	void put ( size_t j, uint64 v, size_t n ) {
+		sums[j] += v ;
+		bytes += n ;
+	}
+	std::vector<VString> strs ;
+	std::vector<std::vector<uint64> > words ;
+	std::vector<VNumeric> nums ;
+} ;
+
+// UDx interfaces:
+class TransformFunction
+{
+public:
+	virtual ~TransformFunction () { }
+	virtual void setup ( ServerInterface &, const SizedColumnTypes & ) { }
+	virtual void destroy ( ServerInterface &, const SizedColumnTypes & ) { }
+	virtual void processPartition ( ServerInterface &, PartitionReader &, PartitionWriter & ) = 0 ;
+	virtual void cancel ( ServerInterface & ) { }
+	bool isCanceled () { return false ; }
+} ;
+
+class TransformFunctionFactory
+{
+public:
+	virtual ~TransformFunctionFactory () { }
+	virtual void getPrototype ( ServerInterface &, ColumnTypes &, ColumnTypes & ) = 0 ;
+	virtual void getReturnType ( ServerInterface &, const SizedColumnTypes &, SizedColumnTypes & ) = 0 ;
+	virtual void getParameterType ( ServerInterface &, SizedColumnTypes & ) { }
+	virtual TransformFunction *createTransformFunction ( ServerInterface & ) = 0 ;
+} ;
+
+// COPY sources:
+enum StreamState { INPUT_NEEDED, OUTPUT_NEEDED, DONE, KEEP_GOING } ;
+
+struct DataBuffer {
+	char *buf ;
+	size_t size ;
+	size_t offset ;
+} ;
+
+class NodeSpecifyingPlanContext
+{
+public:
+	ParamWriter &getWriter () { return writer ; }
+	ParamReader &getReader () { return writer ; }
+	const std::vector<std::string> &getClusterNodes () { return nodes ; }
+	void setTargetNodes ( const std::vector<std::string> &n ) { targets = n ; }
+
+	ParamWriter writer ;
+	std::vector<std::string> nodes ;
+	std::vector<std::string> targets ;
+} ;
+
+class UDSource
+{
+public:
+	virtual ~UDSource () { }
+	virtual void setup ( ServerInterface & ) { }
+	virtual void destroy ( ServerInterface & ) { }
+	virtual StreamState process ( ServerInterface &, DataBuffer & ) = 0 ;
+	virtual void cancel ( ServerInterface & ) { }
+	bool isCanceled () { return false ; }
+} ;
+
+class SourceFactory
+{
+public:
+	virtual ~SourceFactory () { }
+	virtual void plan ( ServerInterface &, NodeSpecifyingPlanContext & ) { }
+	virtual std::vector<UDSource *> prepareUDSources ( ServerInterface &, NodeSpecifyingPlanContext & ) = 0 ;
+	virtual void getParameterType ( ServerInterface &, SizedColumnTypes & ) { }
+} ;
+
+template <class T, class... A>
+T *vt_createFuncObject ( VTAllocator *, A... a ) { return new T(a...) ; }
+
+} // namespace Vertica
+
+inline void vt_report_error ( int code, const char *fmt, ... ) __attribute__((noreturn, format(printf, 2, 3))) ;
+inline void vt_report_error ( int code, const char *fmt, ... )
+{
+	char msg[2048] ;
+	va_list ap ;
+	va_start(ap, fmt) ;
+	vsnprintf(msg, sizeof(msg), fmt, ap) ;
+	va_end(ap) ;
+	throw std::runtime_error("[" + std::to_string(code) + "] " + msg) ;
+}
+
+#define RegisterFactory(f)
+#define RegisterLibrary(...)
@@ -44,6 +44,7 @@ docker-compose exec -T mysql mysql db --password=password -e 'create schema tpch
 docker-compose exec -T mysql mysql db --password=password -e 'create table tpch.customer (id int, name varchar(100), birthday date);' >/dev/null
 docker-compose exec -T mysql mysql db --password=password -e "insert into tpch.customer values (1, 'alice', '1970-01-01');" >/dev/null
 docker-compose exec -T mysql mysql db --password=password -e "insert into tpch.customer values (2, 'bob', '2022-02-02');" >/dev/null
+docker-compose exec -T mysql mysql db --password=password -e 'create table tpch.customer_copy (id int, name varchar(100), birthday date);' >/dev/null
 docker-compose exec -T mysql mysql db --password=password -e "GRANT ALL PRIVILEGES ON tpch.* TO 'mauro'@'%'" >/dev/null
 
 function check_output {
@@ -74,4 +75,21 @@ check_output "Connecting with dblink_secret" "$(docker-compose exec -T vertica v
 SELECT DBLINK(USING PARAMETERS 
     query='select * from tpch.customer order by id') OVER();")"
 
+check_output "Parallel extraction with split_count" "$(docker-compose exec -T vertica vsql -X -c \
+"SELECT * FROM (SELECT DBLINK(slice USING PARAMETERS
+  cid='mysql',
+    query='select * from tpch.customer',
+    split_column='id', split_count=2) OVER(PARTITION BY slice)
+  FROM (SELECT 0 AS slice UNION ALL SELECT 1) s) d ORDER BY id;")"
+
+check_output "Write-back with mode=sink" "$(docker-compose exec -T vertica vsql -X -c \
+"SELECT DBLINK(id, name, birthday USING PARAMETERS
+  cid='mysql', mode='sink',
+    query='insert into tpch.customer_copy values (?, ?, ?)') OVER()
+  FROM (SELECT 1 AS id, 'alice'::VARCHAR(100) AS name, '1970-01-01'::DATE AS birthday
+    UNION ALL SELECT 2, 'bob', '2022-02-02') s;
+SELECT DBLINK(USING PARAMETERS
+  cid='mysql',
+    query='select * from tpch.customer_copy order by id') OVER();")"
+
 # no errors?  Success!
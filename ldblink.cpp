@@ -24,26 +24,404 @@ using namespace std;
 #include <sqlext.h>
 #include <iostream>
 #include <fstream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <deque>
+#include <map>
+#include <memory>
+#include <unordered_set>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/file.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
   
 #define DBLINK_CIDS			"/usr/local/etc/dblink.cids"	// Default Connection identifiers config file FIX: add a param
 #define MAXCNAMELEN			128								// Max column name length
 #define DEF_ROWSET 			100								// Default rowset
 #define MAX_ROWSET 			1000							// Default rowset
+#define MAX_BUDGET_ROWSET	100000							// Max rowset computed from fetch_buffer_mb
+#define MAX_FETCH_BUFFER_MB	4096							// Max fetch_buffer_mb
+#define ADAPT_MIN_ROWSET	16								// Adaptive rowset: minimum array size
+#define ADAPT_FAST_SECS		0.05							// Adaptive rowset: grow below this fetch time
+#define ADAPT_SLOW_SECS		0.5								// Adaptive rowset: shrink above this fetch time
+#define MAX_LOB_LENGTH		32000000						// Max LONG VARCHAR/VARBINARY length
+#define LOB_STREAM_MIN		65536							// Columns wider than this are streamed (lob_stream)
+#define LOB_CHUNK			65536							// SQLGetData chunk size for streamed columns
 #define MAX_NUMERIC_CHARLEN 128								// Max NUMERIC size in characters
 #define MAX_ODBC_ERROR_LEN  1024							// Max ODBC Error Length
+#define MAX_SPLIT			1024							// Max number of split slices
+#define MAX_PIPELINE		8								// Max number of pipelined rowset buffers
+#define MAX_SHARDS			256								// Max number of shards (CIDs) of a call
+#define POOL_MAX_IDLE		32								// Max idle pooled connections (all connection strings)
+#define POOL_MAX_PER_CS		4								// Max idle pooled connections per connection string
+#define POOL_IDLE_SECS		60								// Idle pooled connections are closed after this time
+#define DEF_BATCH			1000							// Sink mode: default rows per SQLExecute
+#define MAX_BATCH			100000							// Sink mode: max rows per SQLExecute
+#define SINK_BUFFER_MB		64								// Sink mode: max size of the parameter arrays
+#define ALIGN8(x)			(((x) + 7) & ~((size_t)7))		// Round up to a multiple of 8 bytes
+#define SCRIPT_SQL_LEN		128								// Script mode: statement text length in the result
+#define ASYNC_POLL_MIN_US	500								// Asynchronous execution: first poll interval
+#define ASYNC_POLL_MAX_US	20000							// Asynchronous execution: max poll interval
+#define DBLINK_CACHE_DIR	"/tmp/dblink_cache"				// Default result cache directory (cache_dir)
+#define DEF_CACHE_MB		1024							// Default result cache size (cache_max_mb)
+#define MAX_CACHE_MB		1048576							// Max cache_max_mb
+#define DEF_CHUNK_ROWS		100000							// Chunked extraction: default rows per chunk (chunk_rows)
+#define DEF_CHUNK_RETRIES	3								// Chunked extraction: default retries of a failed chunk
+#define MAX_CHUNK_RETRIES	100								// Chunked extraction: max chunk_retries
+#define CHUNK_BACKOFF_MS	500								// Chunked extraction: first retry delay (doubled each retry)
+#define CHUNK_BACKOFF_MAX_MS	30000						// Chunked extraction: max retry delay
+#define DBLINK_SLOT_DIR		"/var/tmp/dblink_state/slots"	// Default admission slot directory (cids file "cid%" entries)
+#define ADMIT_WAIT_SECS		60								// Admission control: default max wait for a slot
+#define ADMIT_POLL_MAX_US	200000							// Admission control: max interval between slot polls
+
+// Conversion of a result set column from its bound ODBC C type to the Vertica type.
+// Chosen once per column at describe time (getReturnType):
+enum ColKind {
+	CK_INT = 0,			// SQL_C_SBIGINT -> INTEGER
+	CK_INT_CHAR,		// SQL_C_CHAR -> INTEGER (drivers without SQL_C_SBIGINT)
+	CK_FLOAT,			// SQL_C_DOUBLE -> FLOAT
+	CK_NUMERIC,			// SQL_C_CHAR -> NUMERIC
+	CK_NUMERIC_STRUCT,	// SQL_C_NUMERIC -> NUMERIC (numeric_native, precision <= 38)
+	CK_NUMERIC_INT,		// SQL_C_SBIGINT -> NUMERIC (scale 0, precision <= 18)
+	CK_STRING,			// SQL_C_CHAR/SQL_C_BINARY -> [LONG] [VAR]CHAR/[VAR]BINARY
+	CK_WSTRING,			// SQL_C_WCHAR -> [VAR]CHAR, transcoded to UTF-8 (wide_char)
+	CK_TIME,			// SQL_C_TIME -> TIME
+	CK_DATE,			// SQL_C_DATE -> DATE
+	CK_TIMESTAMP,		// SQL_C_TIMESTAMP -> TIMESTAMP
+	CK_TIMESTAMPTZ,		// SQL_C_TIMESTAMP -> TIMESTAMPTZ (timestamptz parameter)
+	CK_BOOL,			// SQL_C_BIT -> BOOLEAN
+	CK_INTERVAL_YM,		// SQL_C_INTERVAL_YEAR_TO_MONTH -> INTERVAL YEAR TO MONTH
+	CK_INTERVAL_DS,		// SQL_C_INTERVAL_DAY_TO_SECOND -> INTERVAL DAY TO SECOND
+	CK_LOB,				// unbound, read in chunks with SQLGetData -> LONG VARCHAR/LONG VARBINARY
+	CK_KINDS
+};
+
+// Column plan: drives both binding and conversion of a result set column
+struct ColPlan {
+	SQLSMALLINT sqlt ;		// Remote SQL data type
+	SQLULEN size ;			// Remote column size
+	SQLSMALLINT decimals ;	// Remote decimal digits
+	size_t desz ;			// Data element size
+	SQLSMALLINT ctype ;		// ODBC C type used in SQLBindCol
+	ColKind kind ;			// Conversion to the Vertica type
+
+	void set ( size_t d, SQLSMALLINT c, ColKind k ) {
+		desz = d ;
+		ctype = c ;
+		kind = k ;
+	}
+};
+
+// Days from 1970-01-01 to a (proleptic Gregorian) civil date, see H. Hinnant's
+// "chrono-Compatible Low-Level Date Algorithms". Split to be a C++11 constexpr:
+constexpr int64 dfc_era ( int64 y ) { return ( y >= 0 ? y : y - 399 ) / 400 ; }
+constexpr int64 dfc_yoe ( int64 y ) { return y - dfc_era(y) * 400 ; }
+constexpr int64 dfc_doy ( unsigned m, unsigned d ) { return ( 153 * ( m > 2 ? m - 3 : m + 9 ) + 2 ) / 5 + d - 1 ; }
+constexpr int64 dfc_doe ( int64 y, unsigned m, unsigned d ) {
+	return dfc_yoe(y) * 365 + dfc_yoe(y) / 4 - dfc_yoe(y) / 100 + dfc_doy(m, d) ;
+}
+constexpr int64 days_from_civil ( int64 y, unsigned m, unsigned d ) {
+	return dfc_era(y - (m <= 2)) * 146097 + dfc_doe(y - (m <= 2), m, d) - 719468 ;
+}
+#define VT_EPOCH_DAYS		days_from_civil(2000, 1, 1)		// Vertica DATE/TIMESTAMP epoch (days from 1970-01-01)
+static_assert(VT_EPOCH_DAYS == 10957, "days_from_civil(2000, 1, 1)") ;
+
+// Vertica DateADT (days from 2000-01-01) of an ODBC date. No mktime(): no timezone lookups/locks
+// and no DST artifacts.
+inline DateADT date_from_odbc ( SQLSMALLINT y, SQLUSMALLINT m, SQLUSMALLINT d ) {
+	return (DateADT)(days_from_civil(y, m, d) - VT_EPOCH_DAYS) ;
+}
+
+// ODBC date of a Vertica DateADT (inverse of days_from_civil, same source):
+inline void odbc_date ( DateADT dt, SQL_DATE_STRUCT &sd ) {
+	int64 z = (int64)dt + VT_EPOCH_DAYS + 719468 ;
+	int64 era = ( z >= 0 ? z : z - 146096 ) / 146097 ;
+	int64 doe = z - era * 146097 ;
+	int64 yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365 ;
+	int64 doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 ) ;
+	int64 mp = ( 5 * doy + 2 ) / 153 ;
+	sd.month = (SQLUSMALLINT)( mp < 10 ? mp + 3 : mp - 9 ) ;
+	sd.day = (SQLUSMALLINT)( doy - ( 153 * mp + 2 ) / 5 + 1 ) ;
+	sd.year = (SQLSMALLINT)( yoe + era * 400 + ( sd.month <= 2 ) ) ;
+}
+
+// ODBC timestamp of a Vertica Timestamp (microseconds from 2000-01-01):
+inline void odbc_timestamp ( Timestamp ts, SQL_TIMESTAMP_STRUCT &ss ) {
+	SQL_DATE_STRUCT sd ;
+	int64 days = ts / usPerDay - ( ts % usPerDay < 0 ) ;
+	int64 us = ts - days * usPerDay ;
+	odbc_date((DateADT)days, sd) ;
+	ss.year = sd.year ;
+	ss.month = sd.month ;
+	ss.day = sd.day ;
+	ss.hour = (SQLUSMALLINT)( us / usPerHour ) ;
+	ss.minute = (SQLUSMALLINT)( us / usPerMinute % 60 ) ;
+	ss.second = (SQLUSMALLINT)( us / usPerSecond % 60 ) ;
+	ss.fraction = (SQLUINTEGER)( us % usPerSecond * 1000 ) ;
+}
+
+// 10^n, n <= 38 (the precision the fast NUMERIC paths handle)
+inline unsigned __int128 pow10_128 ( int n ) {
+	static const struct Pow10 {
+		unsigned __int128 p[39] ;
+		Pow10 () {
+			p[0] = 1 ;
+			for ( int i = 1 ; i < 39 ; i++ )
+				p[i] = p[i - 1] * 10 ;
+		}
+	} t ;
+	return t.p[n] ;
+}
+
+// Digits allowed by the fast NUMERIC paths in a column of remote size "size" (its Vertica
+// precision, at most 38)
+inline int numeric_precision ( SQLULEN size ) {
+	return size && size < 38 ? (int)size : 38 ;
+}
+
+// Store a signed unscaled decimal into the words of a VNumeric: two's complement, most
+// significant word first. Values are checked against the column precision (at most 38
+// digits), so the low words hold them (one word up to 18 digits) and higher words are sign
+// extension.
+inline void numeric_from_int128 ( VNumeric &vn, unsigned __int128 mag, bool neg ) {
+	unsigned __int128 v = neg ? ~mag + 1 : mag ;
+	int n = vn.nwds ;
+	vn.words[n - 1] = (uint64)v ;
+	if ( n > 1 )
+		vn.words[n - 2] = (uint64)( v >> 64 ) ;
+	for ( int w = 0 ; w < n - 2 ; w++ )
+		vn.words[w] = neg ? ~(uint64)0 : 0 ;
+}
+
+// Allocation-free parse of a plain decimal string ("-123.45", "7", " .5") into its magnitude
+// unscaled to "scale" digits. Returns false for anything else (exponents, fractional digits
+// beyond scale other than trailing zeros, more than "precision" digits...), left to the
+// generic parser.
+inline bool parse_decimal ( const char *s, size_t len, int precision, int scale, unsigned __int128 &mag, bool &neg ) {
+	const char *e = s + len ;
+	int digits = 0, frac = -1 ;
+	bool any = false ;
+
+	while ( s < e && *s == ' ' )
+		s++ ;
+	neg = ( s < e && *s == '-' ) ;
+	if ( s < e && ( *s == '-' || *s == '+' ) )
+		s++ ;
+	for ( mag = 0 ; s < e ; s++ ) {
+		if ( *s >= '0' && *s <= '9' ) {
+			any = true ;
+			if ( frac >= 0 ) {
+				if ( frac == scale ) {		// beyond scale: only trailing zeros are accepted
+					if ( *s != '0' )
+						return false ;
+					continue ;
+				}
+				frac++ ;
+			}
+			if ( ( mag || *s != '0' ) && ++digits > precision )
+				return false ;
+			mag = mag * 10 + (unsigned)( *s - '0' ) ;
+		} else if ( *s == '.' && frac < 0 ) {
+			frac = 0 ;
+		} else {
+			break ;
+		}
+	}
+	while ( s < e && *s == ' ' )
+		s++ ;
+	if ( s != e || !any )
+		return false ;
+	for ( int f = frac < 0 ? 0 : frac ; f < scale ; f++ ) {
+		if ( mag && ++digits > precision )
+			return false ;
+		mag *= 10 ;
+	}
+	neg = neg && mag ;
+	return true ;
+}
 
-SQLHENV Oenv = 0 ;				// ODBC Environment handle
-SQLHDBC Ocon = 0 ;				// ODBC Connection  handle
-SQLHSTMT Ost = 0 ;				// ODBC Statement  handle
-bool is_select = false ;		// Command is a SELECT
-std::string query = "" ;		// set in Factory/getReturnType, used (non-DQL) in processPartition
-SQLUSMALLINT Oncol = 0 ;		// Number of result set columns
-SQLSMALLINT *Odt = 0 ;			// Result set Data Type Array pointer
-SQLSMALLINT *Odd = 0 ;			// Result set Decimals Array pointer
-SQLULEN *Ors = 0 ;				// Result Set Column size pointer
-size_t *desz = 0 ;				// Data Element Size Array pointer
-SQLULEN nfr ;					// Number of fetched rows
-SizedColumnTypes colInfo ;		// Set in getReturnType factory, used in processPartition
+// Eight ASCII digits to their value with a few 64-bit operations (SWAR, little endian).
+// Returns false if any of the eight bytes is not a digit:
+inline bool swar_digits8 ( const char *p, uint64 &val ) {
+	uint64 v ;
+	memcpy(&v, p, 8) ;
+	if ( ( ( v + 0x4646464646464646ULL ) | ( v - 0x3030303030303030ULL ) ) & 0x8080808080808080ULL )
+		return false ;
+	v -= 0x3030303030303030ULL ;
+	v = v * 10 + ( v >> 8 ) ;
+	v = ( ( ( v & 0x000000FF000000FFULL ) * ( 100 + ( 1000000ULL << 32 ) ) )
+		+ ( ( ( v >> 16 ) & 0x000000FF000000FFULL ) * ( 1 + ( 10000ULL << 32 ) ) ) ) >> 32 ;
+	val = v ;
+	return true ;
+}
+
+// Allocation-free parse of an integer string ("-42", " 7 ") checking the 64-bit range.
+// Digits are consumed eight at a time:
+inline bool parse_int64 ( const char *s, size_t len, vint &val ) {
+	const char *e = s + len ;
+	uint64 mag = 0, chunk ;
+	int digits = 0 ;
+
+	while ( s < e && *s == ' ' )
+		s++ ;
+	bool neg = ( s < e && *s == '-' ) ;
+	if ( s < e && ( *s == '-' || *s == '+' ) )
+		s++ ;
+	while ( s < e && *s == '0' )
+		s++, digits = 1 ;
+	const char *d = s ;
+	for ( ; e - s >= 8 && s - d <= 8 && swar_digits8(s, chunk) ; s += 8 )	// up to 16 digits
+		mag = mag * 100000000ULL + chunk ;
+	for ( ; s < e && *s >= '0' && *s <= '9' ; s++ ) {
+		if ( s - d >= 19 )		// 19 digits always fit in 64 unsigned bits
+			return false ;
+		mag = mag * 10 + (uint64)( *s - '0' ) ;
+	}
+	if ( mag > 9223372036854775807ULL + neg )
+		return false ;
+	digits += (int)( s - d ) ;
+	while ( s < e && *s == ' ' )
+		s++ ;
+	if ( s != e || !digits )
+		return false ;
+	val = neg ? (vint)( 0 - mag ) : (vint)mag ;
+	return true ;
+}
+
+// Parse a UTC offset like "+02:00", "-0530", "+1", "UTC" or "Z" into microseconds:
+bool parse_utc_offset ( const std::string &tz, int64 &off ) {
+	int h = 0, m = 0 ;
+	char sign = 0 ;
+
+	if ( tz == "UTC" || tz == "utc" || tz == "Z" || tz == "GMT" ) {
+		off = 0 ;
+		return true ;
+	}
+	if ( tz.size() < 2 || ( tz[0] != '+' && tz[0] != '-' ) )
+		return false ;
+	sign = tz[0] ;
+	if ( sscanf(tz.c_str() + 1, tz.find(':') != std::string::npos ? "%2d:%2d" : "%2d%2d", &h, &m) < 1 )
+		return false ;
+	if ( h > 15 || m > 59 )
+		return false ;
+	off = ( sign == '-' ? -1 : 1 ) * ( h * usPerHour + m * usPerMinute ) ;
+	return true ;
+}
+
+// UTF-16 (or UTF-32 where SQLWCHAR is 4 bytes) to UTF-8, writing at most "max" bytes. Unpaired
+// surrogates become U+FFFD. Runs of ASCII are converted eight units at a time with SSE2.
+// Returns the output length; "*used" is the number of input units converted.
+size_t utf16_to_utf8 ( const SQLWCHAR *s, size_t n, char *d, size_t max, size_t *used ) {
+	size_t i = 0, o = 0 ;
+
+	while ( i < n ) {
+#ifdef __SSE2__
+		if ( sizeof(SQLWCHAR) == 2 ) {
+			const __m128i hi = _mm_set1_epi16((short)0xFF80) ;
+			while ( i + 8 <= n && o + 8 <= max ) {
+				__m128i v = _mm_loadu_si128((const __m128i *)(s + i)) ;
+				if ( _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, hi), _mm_setzero_si128())) != 0xFFFF )
+					break ;
+				_mm_storel_epi64((__m128i *)(d + o), _mm_packus_epi16(v, v)) ;
+				i += 8 ;
+				o += 8 ;
+			}
+			if ( i == n )
+				break ;
+		}
+#endif
+		uint32_t c = (uint32_t)s[i] ;
+		size_t u = 1 ;
+		if ( c >= 0xD800 && c <= 0xDFFF ) {
+			if ( c <= 0xDBFF && i + 1 < n && (uint32_t)s[i+1] >= 0xDC00 && (uint32_t)s[i+1] <= 0xDFFF ) {
+				c = 0x10000 + ( ( c - 0xD800 ) << 10 ) + ( (uint32_t)s[i+1] - 0xDC00 ) ;
+				u = 2 ;
+			} else {
+				c = 0xFFFD ;
+			}
+		} else if ( c > 0x10FFFF ) {
+			c = 0xFFFD ;
+		}
+		size_t k = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4 ;
+		if ( o + k > max )
+			break ;
+		switch ( k ) {
+			case 1:
+				d[o] = (char)c ;
+				break ;
+			case 2:
+				d[o] = (char)( 0xC0 | c >> 6 ) ;
+				d[o+1] = (char)( 0x80 | ( c & 0x3F ) ) ;
+				break ;
+			case 3:
+				d[o] = (char)( 0xE0 | c >> 12 ) ;
+				d[o+1] = (char)( 0x80 | ( c >> 6 & 0x3F ) ) ;
+				d[o+2] = (char)( 0x80 | ( c & 0x3F ) ) ;
+				break ;
+			default:
+				d[o] = (char)( 0xF0 | c >> 18 ) ;
+				d[o+1] = (char)( 0x80 | ( c >> 12 & 0x3F ) ) ;
+				d[o+2] = (char)( 0x80 | ( c >> 6 & 0x3F ) ) ;
+				d[o+3] = (char)( 0x80 | ( c & 0x3F ) ) ;
+		}
+		o += k ;
+		i += u ;
+	}
+	*used = i ;
+	return o ;
+}
+
+// Plan of a wide column bound as SQL_C_WCHAR (wide_char). Its size is in characters and each
+// UTF-16 unit is at most 3 UTF-8 bytes (a surrogate pair is 4), so the Vertica length is exact
+// up to "max", the limit of the Vertica type ([VAR]CHAR or LONG VARCHAR):
+void wide_plan ( ColPlan &cp, size_t max ) {
+	size_t units = std::min(std::max((size_t)cp.size, (size_t)1), max) ;
+	cp.set((units + 1) * sizeof(SQLWCHAR), SQL_C_WCHAR, CK_WSTRING) ;
+	cp.size = std::min(units * 3, max) ;
+}
+
+// What a DBLINK call does with its query (mode parameter):
+enum Modes {
+	MODE_QUERY = 0,		// run the query, return its result set (or the DML return code)
+	MODE_SINK,			// run the parameterized query for each input row (write-back)
+	MODE_LOOKUP,		// run the query for the distinct input keys (IN list), batch by batch
+	MODE_SCRIPT			// run the statements of a script, one result row per statement
+};
+
+// Replace the single "?" parameter marker of "q" (outside quotes) with "n" markers. Returns
+// false if "q" does not have exactly one marker.
+bool expand_marker ( const std::string &q, size_t n, std::string &out ) {
+	size_t pos = std::string::npos ;
+	char quote = 0 ;
+
+	for ( size_t i = 0 ; i < q.size() ; i++ ) {
+		if ( quote ) {
+			if ( q[i] == quote )
+				quote = 0 ;
+		} else if ( q[i] == '\'' || q[i] == '"' ) {
+			quote = q[i] ;
+		} else if ( q[i] == '?' ) {
+			if ( pos != std::string::npos )
+				return false ;
+			pos = i ;
+		}
+	}
+	if ( pos == std::string::npos )
+		return false ;
+	out = q.substr(0, pos) ;
+	for ( size_t k = 0 ; k < n ; k++ )
+		out += k ? ", ?" : "?" ;
+	out += q.substr(pos + 1) ;
+	return true ;
+}
 
 enum DBs {
 	GENERIC = 0,
@@ -55,689 +433,4193 @@ enum DBs {
 	MYSQL
 };
 
-void clean() {
-	if ( Odt ) {
-		free(Odt) ;
-		Odt = 0 ;
-	}
-	if ( Odd ) {
-		free(Odd) ;
-		Odd = 0 ;
-	}
-	if ( Ors ) {
-		free(Ors);
-		Ors = 0 ;
+// Remote DBMS from its SQL_DBMS_NAME:
+DBs dbms_type ( const char *name ) {
+	static const struct { const char *prefix ; DBs dbt ; } names[] = {
+		{ "Oracle", ORACLE }, { "PostgreSQL", POSTGRES }, { "Vertica", VERTICA },
+		{ "Microsoft SQL Server", SQLSERVER }, { "Teradata", TERADATA }, { "MySQL", MYSQL }
+	} ;
+	for ( const auto &n : names )
+		if ( !strncmp(name, n.prefix, strlen(n.prefix)) )
+			return n.dbt ;
+	return GENERIC ;
+}
+
+// Max keys in a lookup IN list of the remote DBMS: SQL Server takes at most 2100 parameters per
+// statement, Oracle 1000 expressions per IN list (ORA-01795), the PostgreSQL and MySQL protocols
+// 65535 parameters
+size_t lookup_max ( DBs dbt ) {
+	switch ( dbt ) {
+		case SQLSERVER:	return 2100 ;
+		case ORACLE:	return 1000 ;
+		case POSTGRES:
+		case MYSQL:		return 65535 ;
+		default:		return MAX_BATCH ;
 	}
-	if ( desz ) {
-		free(desz);
-		desz = 0 ;
+}
+
+// Streaming profiles (streaming parameter): connection options making the driver of each
+// remote DBMS return rows as the remote database produces them, with a bounded prefetch,
+// instead of reading the whole result set in memory before the first fetch. Indexed by DBs.
+struct Profile {
+	const char *name ;		// streaming parameter value
+	const char *options ;	// added to the connection string (options it sets already win)
+} ;
+const Profile profiles[] = {
+	{ "generic", "" },
+	{ "postgres", "UseDeclareFetch=1;Fetch=10000" },	// psqlODBC: FETCH 10000 rows at a time from a cursor
+	{ "vertica", "" },									// streams (ResultBufferSize)
+	{ "sqlserver", "" },								// default result sets stream
+	{ "teradata", "MaxRespSize=1048576" },				// response buffer 1MB (64KB by default)
+	{ "oracle", "FBS=1048576" },						// fetch buffer 1MB (64KB by default)
+	{ "mysql", "NO_CACHE=1;FORWARD_CURSOR=1" }			// Connector/ODBC: mysql_use_result()
+} ;
+
+// Connection string "cs" with the options of "p" it does not set (keys are case insensitive)
+std::string profile_connstr ( const std::string &cs, const Profile &p ) {
+	std::string out = cs ;
+	std::stringstream os ( p.options ) ;
+
+	for ( std::string opt ; std::getline(os, opt, ';') ; ) {
+		std::string key = opt.substr(0, opt.find('=')) ;
+		std::stringstream cl ( cs ) ;
+		bool set = false ;
+		for ( std::string item ; !set && std::getline(cl, item, ';') ; ) {
+			item.erase(std::min(item.size(), item.find('='))) ;
+			item.erase(0, item.find_first_not_of(" \t")) ;
+			item.erase(item.find_last_not_of(" \t") + 1) ;
+			set = !strcasecmp(item.c_str(), key.c_str()) ;
+		}
+		if ( !set )
+			out += ( out.empty() || out.back() == ';' ? "" : ";" ) + opt ;
 	}
-	if ( Ost ) {
-		(void)SQLFreeHandle(SQL_HANDLE_STMT, Ost);
-		Ost = 0 ;
+	return out ;
+}
+
+// Statement attributes of the streaming profiles: forward only, read only cursors
+void stream_stmt ( SQLHSTMT Oh ) {
+	(void)SQLSetStmtAttr(Oh, SQL_ATTR_CURSOR_TYPE, (SQLPOINTER)SQL_CURSOR_FORWARD_ONLY, 0) ;
+	(void)SQLSetStmtAttr(Oh, SQL_ATTR_CONCURRENCY, (SQLPOINTER)SQL_CONCUR_READ_ONLY, 0) ;
+}
+
+// True if the line starting at "i" of "s" is "word" (case insensitive) between blanks. "end"
+// is set to the beginning of the next line.
+bool line_is ( const std::string &s, size_t i, const char *word, size_t &end ) {
+	size_t wl = strlen(word) ;
+	size_t nl = s.find('\n', i) ;
+
+	end = nl == std::string::npos ? s.size() : nl + 1 ;
+	i = s.find_first_not_of(" \t", i) ;
+	if ( i == std::string::npos || i + wl > end || strncasecmp(s.c_str() + i, word, wl) )
+		return false ;
+	i = s.find_first_not_of(" \t\r", i + wl) ;
+	return i == std::string::npos || i == nl ;
+}
+
+// Position of the first character of "st" which is not a blank or in a comment (npos if none):
+size_t skip_comments ( const std::string &st, size_t i = 0 ) {
+	while ( i < st.size() ) {
+		if ( st.compare(i, 2, "--") == 0 ) {
+			i = st.find('\n', i) ;
+		} else if ( st.compare(i, 2, "/*") == 0 ) {
+			i = st.find("*/", i) ;
+			i = i == std::string::npos ? i : i + 2 ;
+		} else if ( isspace((unsigned char)st[i]) ) {
+			i++ ;
+		} else {
+			return i ;
+		}
 	}
-	if ( Ocon ) {
-		(void)SQLDisconnect(Ocon);
-		(void)SQLFreeHandle(SQL_HANDLE_DBC, Ocon);
-		Ocon = 0 ;
+	return std::string::npos ;
+}
+
+// Oracle statements starting a PL/SQL block: their ";" do not end them, a "/" line does.
+bool plsql_block ( const std::string &st ) {
+	static const char *heads[] = { "BEGIN", "DECLARE", "CREATE PROCEDURE", "CREATE FUNCTION", "CREATE PACKAGE",
+		"CREATE TRIGGER", "CREATE TYPE", "CREATE OR REPLACE PROCEDURE", "CREATE OR REPLACE FUNCTION",
+		"CREATE OR REPLACE PACKAGE", "CREATE OR REPLACE TRIGGER", "CREATE OR REPLACE TYPE" } ;
+	std::string w ;
+
+	// First words, upper case, single blank separated:
+	for ( size_t i = skip_comments(st) ; i < st.size() && isalpha((unsigned char)st[i]) && w.size() < 32 ;
+			i = skip_comments(st, i) ) {
+		for ( ; i < st.size() && ( isalnum((unsigned char)st[i]) || st[i] == '_' ) ; i++ )
+			w += (char)toupper((unsigned char)st[i]) ;
+		w += ' ' ;
 	}
-	if ( Oenv ) {
-		(void)SQLFreeHandle(SQL_HANDLE_ENV, Oenv);
-		Oenv = 0 ;
+	for ( const char *h : heads )
+		if ( !strncmp(w.c_str(), h, strlen(h)) && w[strlen(h)] == ' ' )
+			return true ;
+	return false ;
+}
+
+// Split a script in statements the way the remote database client tools do. Statements end
+// with ";" outside quoted strings, quoted identifiers and comments, and
+//	- PostgreSQL/Vertica: dollar quoted strings ($tag$...$tag$) are skipped
+//	- MySQL: backquoted identifiers, backslash escapes, "#" comments and DELIMITER lines
+//	- SQL Server: scripts with GO lines are split in batches on them (";" is left to the server)
+//	- Oracle: a "/" line ends a statement, and PL/SQL blocks keep their ";"
+// Empty (or comment only) statements are dropped, comments inside statements are kept.
+std::vector<std::string> split_script ( const std::string &s, DBs dbt )
+{
+	std::vector<std::string> out ;
+	std::string delim = ";" ;
+	bool go = false ;
+	size_t start = 0, i = 0, end = 0 ;
+
+	auto push = [&] ( size_t e ) {
+		std::string st = s.substr(start, std::min(e, s.size()) - start) ;
+		st.erase(0, st.find_first_not_of(" \n\t\r")) ;
+		st.erase(st.find_last_not_of(" \n\t\r") + 1) ;
+		if ( skip_comments(st) != std::string::npos )
+			out.push_back(st) ;
+	} ;
+
+	for ( size_t l = 0 ; dbt == SQLSERVER && l < s.size() && !go ; l = end )
+		go = line_is(s, l, "GO", end) ;
+	while ( i < s.size() ) {
+		char c = s[i] ;
+
+		// Client commands (whole lines):
+		if ( i == 0 || s[i - 1] == '\n' ) {
+			if ( ( go && line_is(s, i, "GO", end) ) || ( dbt == ORACLE && line_is(s, i, "/", end) ) ) {
+				push(i) ;
+				start = i = end ;
+				continue ;
+			}
+			if ( dbt == MYSQL && !strncasecmp(s.c_str() + i, "DELIMITER ", 10) ) {
+				push(i) ;
+				end = s.find('\n', i) ;
+				end = end == std::string::npos ? s.size() : end ;
+				std::string d = s.substr(i + 10, end - i - 10) ;
+				d.erase(0, d.find_first_not_of(" \t\r")) ;
+				d.erase(d.find_last_not_of(" \t\r") + 1) ;
+				if ( !d.empty() )
+					delim = d ;
+				start = i = end ;
+				continue ;
+			}
+		}
+		if ( c == '\'' || c == '"' || ( c == '`' && dbt == MYSQL ) || ( c == '[' && dbt == SQLSERVER ) ) {
+			char q = c == '[' ? ']' : c ;
+			for ( i++ ; i < s.size() && s[i] != q ; i++ ) {
+				if ( s[i] == '\\' && dbt == MYSQL && q != '`' )
+					i++ ;
+			}
+			i++ ;
+		} else if ( s.compare(i, 2, "--") == 0 || ( c == '#' && dbt == MYSQL ) ) {
+			i = s.find('\n', i) ;
+		} else if ( s.compare(i, 2, "/*") == 0 ) {
+			i = s.find("*/", i + 2) ;
+			i = i == std::string::npos ? i : i + 2 ;
+		} else if ( c == '$' && ( dbt == POSTGRES || dbt == VERTICA ) ) {
+			size_t t = i + 1 ;
+			while ( t < s.size() && ( isalnum((unsigned char)s[t]) || s[t] == '_' ) )
+				t++ ;
+			if ( t < s.size() && s[t] == '$' && !isdigit((unsigned char)s[i + 1]) &&
+					( i == 0 || !( isalnum((unsigned char)s[i - 1]) || s[i - 1] == '_' ) ) ) {
+				size_t e = s.find(s.substr(i, t - i + 1), t + 1) ;
+				i = e == std::string::npos ? e : e + t - i + 1 ;
+			} else {
+				i++ ;
+			}
+		} else if ( !go && s.compare(i, delim.size(), delim) == 0 &&
+				!( dbt == ORACLE && plsql_block(s.substr(start, i - start)) ) ) {
+			push(i) ;
+			start = i = i + delim.size() ;
+		} else {
+			i++ ;
+		}
 	}
+	push(s.size()) ;
+	return out ;
 }
 
-void ex_err ( SQLSMALLINT htype, SQLHANDLE Oh, int loc , const char *vtext ) {
+// First diagnostic record of handle "Oh", as "State S. Native Code N. Error text: T."
+std::string odbc_diag ( SQLSMALLINT htype, SQLHANDLE Oh ) {
 	SQLCHAR Oerr_state[6] ;					// ODBC Error State
 	SQLINTEGER Oerr_native = 0 ;			// ODBC Error Native Code
 	SQLCHAR Oerr_text[MAX_ODBC_ERROR_LEN] ;	// ODBC Error Text
-	SQLRETURN Oret = 0 ;
 	SQLSMALLINT Oln = 0 ;
+	char Omsg[MAX_ODBC_ERROR_LEN + 64] ;
 
 	Oerr_state[0] = Oerr_text[0] = '\0' ;
+	if ( SQLGetDiagRec ( htype, Oh, 1, Oerr_state, &Oerr_native, Oerr_text,
+			(SQLSMALLINT)MAX_ODBC_ERROR_LEN, &Oln) != SQL_SUCCESS )
+		return "Unable to display ODBC error message" ;
+	snprintf(Omsg, sizeof(Omsg), "State %s. Native Code %d. Error text: %s%c", (char *)Oerr_state, (int)Oerr_native,
+		(char *) Oerr_text, ( Oln > MAX_ODBC_ERROR_LEN ) ? '>' : '.') ;
+	return Omsg ;
+}
 
+// Report an ODBC error. With "release" the connection Oh is freed once its diagnostics are read:
+void ex_err ( SQLSMALLINT htype, SQLHANDLE Oh, int loc , const char *vtext, bool release = false ) {
 	if ( htype == 0 ) {
 		vt_report_error(loc, "DBLINK. %s", vtext);
-	} else if ( ( Oret = SQLGetDiagRec ( htype, Oh, 1, Oerr_state, &Oerr_native, Oerr_text,
-			(SQLSMALLINT)MAX_ODBC_ERROR_LEN, &Oln) ) != SQL_SUCCESS ) {
-		clean();
-		vt_report_error(loc, "DBLINK. %s. Unable to display ODBC error message", vtext);
-	} else {
-		clean();
-		vt_report_error(loc, "DBLINK. %s. State %s. Native Code %d. Error text: %s%c",
-			vtext, (char *)Oerr_state, (int)Oerr_native, (char *) Oerr_text,
-			( Oln > MAX_ODBC_ERROR_LEN ) ? '>' : '.' ) ;
 	}
+	std::string diag = odbc_diag(htype, Oh) ;
+	if ( release ) {
+		(void)SQLFreeHandle(SQL_HANDLE_DBC, (SQLHDBC)Oh);
+	}
+	vt_report_error(loc, "DBLINK. %s. %s", vtext, diag.c_str()) ;
 }
 
-class DBLink : public TransformFunction
+// Create directory "dir" and its missing parents (mkdir -p), private to the Vertica user
+void mkdirs ( const std::string &dir ) {
+	for ( size_t i = dir.find('/', 1) ; ; i = dir.find('/', i + 1) ) {
+		(void)mkdir(dir.substr(0, i).c_str(), 0700) ;
+		if ( i == std::string::npos )
+			break ;
+	}
+}
+
+// Admission control of a CID (its "cid%" entry in the cids file, for example
+// "pgdb%:max=8;wait=120"): at most "max" connections open per node to its remote database (in
+// use or pooled), waiting up to "wait" seconds for one to be released. The slots are lock files under "dir"
+// (flock), shared by all the Vertica processes of the node, or of the cluster when "dir" is on
+// a shared file system with working locks.
+struct Admission {
+	std::string cid ;				// CID name: its connection strings share the slots
+	size_t max = 0 ;				// Max connections in use, 0 if not limited
+	size_t wait = ADMIT_WAIT_SECS ;	// Max wait for a slot (seconds)
+	std::string dir = DBLINK_SLOT_DIR ;
+
+	// Read a "key=value;..." entry. Returns false on unknown keys or bad values.
+	bool parse ( const std::string &entry ) {
+		std::stringstream es ( entry ) ;
+
+		for ( std::string item ; std::getline(es, item, ';') ; ) {
+			size_t eq = item.find('=') ;
+			std::string key = item.substr(0, eq), value = eq == std::string::npos ? "" : item.substr(eq + 1) ;
+			key.erase(0, key.find_first_not_of(" \t")) ;
+			key.erase(key.find_last_not_of(" \t") + 1) ;
+			if ( key.empty() )
+				continue ;
+			if ( key == "dir" && !value.empty() )
+				dir = value ;
+			else if ( ( key == "max" || key == "wait" ) && !value.empty() && value.find_first_not_of("0123456789") == std::string::npos )
+				( key == "max" ? max : wait ) = (size_t)strtoull(value.c_str(), NULL, 10) ;
+			else
+				return false ;
+		}
+		return true ;
+	}
+} ;
+
+// Connection registry. One per process: all DBLINK calls of an unfenced node, or of the
+// fenced UDx side process, share the parsed cids files (reloaded when their mtime or size
+// change), a single ODBC environment and a bounded pool of idle connections keyed by the
+// resolved connection string. Pooled connections are rolled back and reset when released,
+// checked with SQL_ATTR_CONNECTION_DEAD before reuse and closed after POOL_IDLE_SECS.
+// Connections of CIDs with an admission limit hold a slot of their CID until closed, pooled
+// included: they are only reused for the same CID, and closed when it needs the slot.
+class Registry
 {
+	struct CidFile {
+		time_t mtime ;
+		off_t size ;
+		std::map<std::string, std::string> cids ;	// CID name (env entries keep the '$') -> value
+	} ;
+	struct Idle {
+		std::string cs ;
+		std::string cid ;			// CID of its admission slot, empty if not limited
+		SQLHDBC con ;
+		std::chrono::steady_clock::time_point since ;
+	} ;
+	struct Slot {
+		int fd ;					// Locked slot file descriptor...
+		std::string file ;			// ...and path
+		std::string cid ;
+	} ;
 
-	DBs dbt ;
-	SQLPOINTER *Ores ;     // result array pointers pointer
-	SQLLEN **Olen ;        // length array pointers pointer
-	StringParsers parser ;
-	size_t rowset ;		// Fetch rowset
+	std::mutex mtx ;
+	SQLHENV env = 0 ;
+	std::map<std::string, CidFile> files ;
+	std::deque<Idle> idle ;						// least recently released first
+	std::map<std::string, DBs> dbms_seen ;		// remote DBMS of the connection strings used so far
+	std::map<std::string, bool> bigint_seen ;	// SQL_C_SBIGINT probe result of the connection strings
+	std::map<SQLHDBC, Slot> slots ;				// open connections (in use or pooled) holding a slot
+	std::unordered_set<std::string> locked ;	// slot files locked by this process
 
-	virtual void setup(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
-	{
-		SQLRETURN Oret = 0 ;
-		SQLHSTMT Ostmt = 0 ;
-		SQLCHAR Obuff[64];
+	static void disconnect ( SQLHDBC con ) {
+		(void)SQLDisconnect(con);
+		(void)SQLFreeHandle(SQL_HANDLE_DBC, con);
+	}
 
-		memset(&Obuff[0], 0, sizeof(Obuff));
+	// Close "con" and give back its admission slot, if any (caller holds mtx)
+	void drop ( SQLHDBC con ) {
+		std::map<SQLHDBC, Slot>::iterator it = slots.find(con) ;
 
-		// Check the DBMS we are connecting to:
-		if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Ostmt))){
-			ex_err(SQL_HANDLE_DBC, Ocon, 201, "Error allocating Statement Handle");
+		disconnect(con) ;
+		if ( it != slots.end() ) {
+			close(it->second.fd) ;
+			locked.erase(it->second.file) ;
+			slots.erase(it) ;
 		}
-		if (!SQL_SUCCEEDED(Oret=SQLGetInfo(Ocon, SQL_DBMS_NAME,
-        	(SQLPOINTER)Obuff, (SQLSMALLINT)sizeof(Obuff), NULL))) {
-			ex_err(SQL_HANDLE_DBC, Ocon, 202, "Error getting remote DBMS Name");
-    	}
-		if ( !strcmp((char *)Obuff, "Oracle") ) {
-			dbt = ORACLE ;
-		} else {
-			dbt = GENERIC ;
+	}
+
+	// Close idle connections past their timeout (caller holds mtx):
+	void expire () {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now() ;
+		while ( !idle.empty() && now - idle.front().since > std::chrono::seconds(POOL_IDLE_SECS) ) {
+			drop(idle.front().con) ;
+			idle.pop_front() ;
 		}
-        (void)SQLFreeHandle(SQL_HANDLE_STMT, Ostmt);
+	}
 
-		// Read/Set rowset Param:
-		ParamReader params = srvInterface.getParamReader();
-		if( params.containsParameter("rowset") ) {
-			vint rowset_param = params.getIntRef("rowset") ;
-			if ( rowset_param < 1 || rowset_param > MAX_ROWSET ) {
-				ex_err(0, 0, 203, "DBLINK. Error rowset out of range");
-			} else {
-				rowset = (size_t) rowset_param ;
+	// Close the least recently released idle connection of "cid", freeing its slot. Returns
+	// false if there is none.
+	bool reclaim ( const std::string &cid ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		for ( std::deque<Idle>::iterator it = idle.begin() ; it != idle.end() ; ++it ) {
+			if ( it->cid == cid ) {
+				drop(it->con) ;
+				idle.erase(it) ;
+				return true ;
 			}
-		} else {
-			rowset = DEF_ROWSET ;
 		}
+		return false ;
 	}
 
-    virtual void cancel(ServerInterface &srvInterface)
-    {
-		SQLRETURN Oret = 0 ;
-		if ( Ost ) {
-			if (!SQL_SUCCEEDED(Oret=SQLCancel(Ost)))
-				ex_err(SQL_HANDLE_STMT, Ost, 301, "Error canceling SQL statement");
-        }
-		clean() ;
-    }
+	// Parsed cids "file", reloaded if modified (caller holds mtx). NULL if it cannot be read.
+	const CidFile *load ( const std::string &file ) {
+		struct stat st ;
 
-    virtual void destroy(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
-    {
-		clean() ;
-    }
+		if ( stat(file.c_str(), &st) )
+			return NULL ;
+		CidFile &cf = files[file] ;
+		if ( cf.cids.empty() || cf.mtime != st.st_mtime || cf.size != st.st_size ) {
+			std::ifstream cids(file) ;
+			std::string cline ;
+			size_t pos ;
+			if ( !cids.is_open() ) {
+				files.erase(file) ;
+				return NULL ;
+			}
+			cf.cids.clear() ;
+			while ( getline(cids, cline) ) {
+				if ( cline[0] == '#' || cline.empty() )
+					continue ;	// skip empty lines & comments
+				if ( ( pos = cline.find(":") ) != std::string::npos )
+					cf.cids[cline.substr(0, pos)] = cline.substr(pos + 1, std::string::npos) ;
+				// skip malformed lines
+			}
+			cf.mtime = st.st_mtime ;
+			cf.size = st.st_size ;
+		}
+		return &cf ;
+	}
 
-    virtual void processPartition(ServerInterface &srvInterface,
-                                  PartitionReader & inputReader,
-                                  PartitionWriter & outputWriter)
-	{
-		SQLRETURN Oret = 0 ;
-		SQLPOINTER Odp = 0 ; // Data Element Pointer
-		SQLULEN    Odl = 0 ; // Data Element Length
+public:
+	// Look up "cid" (and its "cid$" environment and "cid%" admission entries) in the cids
+	// file. Returns false if the file cannot be read.
+	bool cid ( const std::string &file, const std::string &name, std::string &value, std::string &envs, std::string &admit ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		const CidFile *cf = load(file) ;
 
-		try
-		{
-			if ( is_select ) {
-
-				// Allocate memory for Result Set and length array pointers:
-				Ores = (SQLPOINTER *)srvInterface.allocator->alloc(Oncol * sizeof(SQLPOINTER)) ;
-				Olen = (SQLLEN **)srvInterface.allocator->alloc(Oncol * sizeof(SQLLEN *)) ;
-
-				// Allocate space for each column and bind it:
-				for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
-					Olen[j] = (SQLLEN *)srvInterface.allocator->alloc(sizeof(SQLLEN) * rowset);
-					switch(Odt[j]) {
-						case SQL_SMALLINT:
-						case SQL_INTEGER:
-						case SQL_TINYINT:
-						case SQL_BIGINT:
-							if ( dbt == ORACLE )
-								desz[j] = (size_t)(Ors[j] + 1) ;
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, (dbt==ORACLE) ? SQL_C_CHAR : SQL_C_SBIGINT, Ores[j], desz[j], Olen[j]))){
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							}
-							break ;
-						case SQL_REAL:
-						case SQL_DOUBLE:
-						case SQL_FLOAT:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_DOUBLE, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_NUMERIC:
-						case SQL_DECIMAL:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_CHAR, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_WCHAR:
-						case SQL_WVARCHAR:
-						case SQL_WLONGVARCHAR:
-						case SQL_CHAR:
-						case SQL_VARCHAR:
-						case SQL_LONGVARCHAR:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_CHAR, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_TYPE_TIME:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_TIME, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_TYPE_DATE:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_DATE, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_TYPE_TIMESTAMP:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_TIMESTAMP, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_BIT:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_BIT, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_BINARY:
-						case SQL_VARBINARY:
-						case SQL_LONGVARBINARY:
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_BINARY, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_INTERVAL_YEAR_TO_MONTH:
-							// FIX: support this data type
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_INTERVAL_YEAR_TO_MONTH, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break ;
-						case SQL_INTERVAL_DAY_TO_SECOND:
-							// FIX: support this data type
-							Ores[j] = (SQLPOINTER)srvInterface.allocator->alloc(desz[j] * rowset);
-							if (!SQL_SUCCEEDED(Oret=SQLBindCol(Ost, j+1, SQL_C_INTERVAL_DAY_TO_SECOND, Ores[j], desz[j], Olen[j])))
-								ex_err(SQL_HANDLE_STMT, Ost, 401, "Error binding column");
-							break;
-					}
+		if ( !cf )
+			return false ;
+		std::map<std::string, std::string>::const_iterator it ;
+		value = ( it = cf->cids.find(name) ) != cf->cids.end() ? it->second : "" ;
+		envs = ( it = cf->cids.find(name + "$") ) != cf->cids.end() ? it->second : "" ;
+		admit = ( it = cf->cids.find(name + "%") ) != cf->cids.end() ? it->second : "" ;
+		return true ;
+	}
+
+	// Expand a comma separated list of CID names and patterns ("*" and "?" wildcards) to the
+	// CID names of "file" (shards). Patterns expand to the matching names in name order.
+	bool cids ( const std::string &file, const std::string &list, std::vector<std::string> &names ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		const CidFile *cf = load(file) ;
+		std::stringstream ls ( list ) ;
+		std::string item ;
+
+		if ( !cf )
+			return false ;
+		while ( std::getline ( ls, item, ',' ) ) {
+			item.erase(0, item.find_first_not_of(" \t")) ;
+			item.erase(item.find_last_not_of(" \t") + 1) ;
+			if ( item.find_first_of("*?") == std::string::npos ) {
+				if ( !item.empty() && std::find(names.begin(), names.end(), item) == names.end() )
+					names.push_back(item) ;
+				continue ;
+			}
+			for ( std::map<std::string, std::string>::const_iterator it = cf->cids.begin() ; it != cf->cids.end() ; ++it ) {
+				if ( it->first.back() != '$' && it->first.back() != '%' && !fnmatch(item.c_str(), it->first.c_str(), 0) &&
+						std::find(names.begin(), names.end(), it->first) == names.end() )
+					names.push_back(it->first) ;
+			}
+		}
+		return true ;
+	}
+
+	// Remote DBMS of connection string "cs" (streaming profiles), if known from a previous call
+	bool dbms ( const std::string &cs, DBs &dbt ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		std::map<std::string, DBs>::const_iterator it = dbms_seen.find(cs) ;
+
+		if ( it == dbms_seen.end() )
+			return false ;
+		dbt = it->second ;
+		return true ;
+	}
+
+	void learn ( const std::string &cs, DBs dbt ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		dbms_seen[cs] = dbt ;
+	}
+
+	// SQL_C_SBIGINT support of the driver of "cs", if probed by a previous call
+	bool bigint ( const std::string &cs, bool &ok ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		std::map<std::string, bool>::const_iterator it = bigint_seen.find(cs) ;
+
+		if ( it == bigint_seen.end() )
+			return false ;
+		ok = it->second ;
+		return true ;
+	}
+
+	void learn_bigint ( const std::string &cs, bool ok ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		bigint_seen[cs] = ok ;
+	}
+
+	// Get a connection for "cs": a pooled one of the same CID (holding its slot), or a new one
+	// after waiting for an admission slot if the CID is limited ("adm", NULL if not). "waited"
+	// gets the wait in seconds. Errors are reported with codes loc to loc+3.
+	SQLHDBC connect ( const std::string &cs, const Admission *adm, int loc, double *waited = NULL ) {
+		std::string slot ;
+		SQLHDBC con = pooled(cs, adm ? adm->cid : "", loc) ;
+		int fd = -1 ;
+
+		if ( waited )
+			*waited = 0 ;
+		if ( con )
+			return con ;
+		if ( adm )
+			fd = admit(*adm, loc, slot, waited) ;
+		try {
+			con = open(cs, loc) ;
+		} catch ( ... ) {
+			unlock(fd, slot) ;
+			throw ;
+		}
+		if ( fd >= 0 ) {
+			std::lock_guard<std::mutex> lock(mtx) ;
+			Slot sl = { fd, slot, adm->cid } ;
+			slots[con] = sl ;
+		}
+		return con ;
+	}
+
+private:
+	// Take a free admission slot of CID adm.cid, polling at growing intervals up to the CID wait
+	// ("waited" is 0 if a slot was free). The idle connections of the CID in this process are
+	// closed first. Returns the locked slot file descriptor. Slots locked by this process are
+	// skipped: some file systems lock per process, not per descriptor.
+	int admit ( const Admission &adm, int loc, std::string &slot, double *waited ) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+		long us = ASYNC_POLL_MIN_US ;
+		bool queued = false ;
+
+		mkdirs(adm.dir) ;
+		for ( ;; ) {
+			for ( size_t i = 0 ; i < adm.max ; i++ ) {
+				slot = adm.dir + "/" + adm.cid + "." + std::to_string((unsigned long long)i) ;
+				{
+					std::lock_guard<std::mutex> lock(mtx) ;
+					if ( !locked.insert(slot).second )
+						continue ;
 				}
-				// Set Statement attributes:
-				if (!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ost, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0))) {
-					ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROW_BIND_TYPE");
+				int fd = ::open(slot.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600) ;
+				if ( fd >= 0 && !flock(fd, LOCK_EX | LOCK_NB) ) {
+					if ( waited && queued )
+						*waited = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() ;
+					return fd ;
 				}
-				if (!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ost, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)rowset, 0))) {
-					ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROW_ARRAY_SIZE");
+				int err = errno ;
+				unlock(fd, slot) ;
+				if ( fd < 0 || err != EWOULDBLOCK ) {
+					vt_report_error(loc + 3, "DBLINK. Cannot lock the admission slot <%s> of CID <%s>: %s", slot.c_str(), adm.cid.c_str(), strerror(err));
+				}
+			}
+			if ( reclaim(adm.cid) )
+				continue ;
+			if ( std::chrono::steady_clock::now() - t0 >= std::chrono::seconds(adm.wait) ) {
+				vt_report_error(loc + 3, "DBLINK. No free connection to CID <%s> after %zu seconds (max %zu per node)", adm.cid.c_str(), adm.wait, adm.max);
+			}
+			queued = true ;
+			std::this_thread::sleep_for(std::chrono::microseconds(us)) ;
+			us = std::min(us * 2, (long)ADMIT_POLL_MAX_US) ;
+		}
+	}
+
+	// Give back an admission slot taken by admit()
+	void unlock ( int fd, const std::string &slot ) {
+		if ( fd >= 0 )
+			close(fd) ;
+		if ( !slot.empty() ) {
+			std::lock_guard<std::mutex> lock(mtx) ;
+			locked.erase(slot) ;
+		}
+	}
+
+	// A live idle connection for "cs" pooled by CID "cid" (empty if not limited), 0 if none
+	SQLHDBC pooled ( const std::string &cs, const std::string &cid, int loc ) {
+		SQLRETURN Oret = 0 ;
+		SQLHDBC con = 0 ;
+
+		for ( ;; ) {
+			{
+				std::lock_guard<std::mutex> lock(mtx) ;
+				if ( !env ) {
+					if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_ENV, (SQLHANDLE)SQL_NULL_HANDLE, &env))){
+						env = 0 ;
+						ex_err(0, 0, loc, "Error allocating Environment Handle");
+					}
+					if (!SQL_SUCCEEDED(Oret=SQLSetEnvAttr(env, SQL_ATTR_ODBC_VERSION, (void *) SQL_OV_ODBC3, 0))){
+						(void)SQLFreeHandle(SQL_HANDLE_ENV, env);
+						env = 0 ;
+						ex_err(0, 0, loc + 1, "Error setting SQL_OV_ODBC3");
+					}
 				}
-				if (!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ost, SQL_ATTR_ROWS_FETCHED_PTR, &nfr, 0))) {
-					ex_err(SQL_HANDLE_STMT, Ost, 402, "Error setting statement attribute SQL_ATTR_ROWS_FETCHED_PTR");
+				expire() ;
+				con = 0 ;
+				for ( std::deque<Idle>::reverse_iterator it = idle.rbegin() ; it != idle.rend() ; ++it ) {
+					if ( it->cs == cs && it->cid == cid ) {
+						con = it->con ;
+						idle.erase(std::next(it).base()) ;
+						break ;
+					}
 				}
+			}
+			if ( !con )
+				return 0 ;
+			SQLUINTEGER dead = SQL_CD_FALSE ;	// drivers not supporting the attribute: assume alive
+			if ( !SQL_SUCCEEDED(SQLGetConnectAttr(con, SQL_ATTR_CONNECTION_DEAD, &dead, 0, NULL)) || dead == SQL_CD_FALSE )
+				return con ;
+			std::lock_guard<std::mutex> lock(mtx) ;
+			drop(con) ;
+		}
+	}
+
+	// A new connection for "cs"
+	SQLHDBC open ( const std::string &cs, int loc ) {
+		SQLRETURN Oret = 0 ;
+		SQLHDBC con = 0 ;
+
+		if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_DBC, env, &con))){
+			ex_err(0, 0, loc + 2, "Error allocating Connection Handle");
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLDriverConnect(con, (SQLHWND)NULL, (SQLCHAR *)cs.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT))){
+			ex_err(SQL_HANDLE_DBC, con, loc + 3, "Error connecting to target database", true);
+		}
+		return con ;
+	}
+
+public:
+	// Give back a connection (all its statements freed). It is pooled with its admission slot
+	// if "reuse" and the session reset succeeds, closed (giving back the slot) otherwise.
+	void release ( const std::string &cs, SQLHDBC con, bool reuse ) {
+		if ( reuse ) {
+			reuse = SQL_SUCCEEDED(SQLEndTran(SQL_HANDLE_DBC, con, SQL_ROLLBACK)) &&
+				SQL_SUCCEEDED(SQLSetConnectAttr(con, SQL_ATTR_AUTOCOMMIT, (SQLPOINTER)SQL_AUTOCOMMIT_ON, 0)) ;
+#ifdef SQL_ATTR_RESET_CONNECTION	/* ODBC 3.8 */
+			(void)SQLSetConnectAttr(con, SQL_ATTR_RESET_CONNECTION, (SQLPOINTER)SQL_RESET_CONNECTION_YES, 0) ;
+#endif
+		}
+		if ( reuse ) {
+			std::lock_guard<std::mutex> lock(mtx) ;
+			size_t n = 0 ;
+			expire() ;
+			for ( std::deque<Idle>::const_iterator it = idle.begin() ; it != idle.end() ; ++it )
+				n += ( it->cs == cs ) ;
+			if ( n < POOL_MAX_PER_CS && idle.size() < POOL_MAX_IDLE ) {
+				std::map<SQLHDBC, Slot>::const_iterator sl = slots.find(con) ;
+				Idle i = { cs, sl != slots.end() ? sl->second.cid : "", con, std::chrono::steady_clock::now() } ;
+				idle.push_back(i) ;
+				return ;
+			}
+		}
+		Slot sl = { -1, "", "" } ;
+		{
+			std::lock_guard<std::mutex> lock(mtx) ;
+			std::map<SQLHDBC, Slot>::iterator it = slots.find(con) ;
+			if ( it != slots.end() ) {
+				sl = it->second ;
+				slots.erase(it) ;
+			}
+		}
+		disconnect(con) ;
+		unlock(sl.fd, sl.file) ;
+	}
+} ;
+Registry registry ;
+
+inline double secs_since ( std::chrono::steady_clock::time_point t0 ) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() ;
+}
+
+// Phase timings (seconds) and counters. The describe phases are measured by describe(), the
+// others by each instance for each partition; everything is logged in the UDx log and
+// optionally appended to the stats_file.
+struct Stats
+{
+	double cids = 0 ;				// Connection string lookup (CIDs file)
+	double connect = 0 ;			// Connection (from the pool or SQLDriverConnect)
+	double describe = 0 ;			// Prepare and describe (split range probe included)
+	double execute = 0 ;			// SQLExecute/SQLExecDirect
+	double first_row = 0 ;			// From the (first) execution to the first rowset
+	double fetch = 0 ;				// Waiting for SQLFetchScroll
+	double convert = 0 ;			// Converting rowsets to Vertica values (streamed columns included)
+	size_t rows = 0 ;				// Rows fetched (or written, in sink mode)
+	size_t bytes = 0 ;				// Bytes fetched (values lengths)
+	size_t fetches = 0 ;			// SQLFetchScroll round trips
+	double admit = 0 ;				// Waiting for admission slots (part of connect)
+	size_t queued = 0 ;				// Connections that waited for an admission slot
+
+	// Count a connection that waited "waited" seconds for its admission slot
+	void wait ( double waited ) {
+		admit += waited ;
+		queued += waited > 0 ;
+	}
+
+	std::string line () const {
+		char buf[512] ;
+		snprintf(buf, sizeof(buf), "cids=%.6f connect=%.6f describe=%.6f execute=%.6f first_row=%.6f "
+			"fetch=%.6f convert=%.6f rows=%zu bytes=%zu fetches=%zu admit=%.6f queued=%zu",
+			cids, connect, describe, execute, first_row, fetch, convert, rows, bytes, fetches, admit, queued) ;
+		return buf ;
+	}
+} ;
+
+// Local result cache (cache_ttl). The results of plain SELECTs are kept in files under
+// cache_dir, one per connection string, normalized query and result-affecting parameters,
+// and served from there (mapped in memory, no ODBC at all) until they are cache_ttl seconds
+// old. Files are columnar:
+//
+//     CacheHead | CacheCol[ncol] | names | for each column: NULL bitmap, values, string bytes
+//
+// fixed size values (8 bytes, 1 for BOOLEAN, the VNumeric words for NUMERIC) or, for strings,
+// rows + 1 offsets in the string bytes. Sections are 8 bytes aligned. Only hashes of the key
+// are stored (connection strings hold credentials) and the directory is evicted least
+// recently used first (hits touch the file mtime) to stay under cache_max_mb.
+#define CACHE_MAGIC "DBLCACH1"
+
+struct CacheHead {
+	char magic[8] ;
+	uint64 hash[2] ;		// Key hashes
+	int64 created ;			// Unix time
+	uint64 rows ;
+	uint32 ncol ;
+	uint32 spare ;
+	uint64 size ;			// File size (truncated files are ignored)
+	uint64 spare2 ;
+} ;
+
+struct CacheCol {
+	SQLSMALLINT sqlt ;		// Column plan built by describe()...
+	SQLSMALLINT decimals ;
+	int32 kind ;
+	uint64 size ;
+	uint32 width ;			// ...value size (0: strings)
+	uint32 namelen ;
+	uint64 name ;			// Offsets in the file
+	uint64 nulls ;
+	uint64 data ;
+	uint64 vars ;
+} ;
+
+// Queries differing in blanks only share their cache entry: runs of blanks outside quotes
+// become a single space, leading/trailing blanks and semicolons are dropped.
+std::string cache_query ( const std::string &q ) {
+	std::string n ;
+	char quote = 0 ;
+
+	for ( size_t i = 0 ; i < q.size() ; i++ ) {
+		char c = q[i] ;
+		if ( quote ) {
+			quote = c == quote ? 0 : quote ;
+		} else if ( c == '\'' || c == '"' ) {
+			quote = c ;
+		} else if ( isspace((unsigned char)c) ) {
+			if ( !n.empty() && n.back() != ' ' )
+				n += ' ' ;
+			continue ;
+		}
+		n += c ;
+	}
+	n.erase(n.find_last_not_of(" ;") + 1) ;
+	return n ;
+}
+
+// 64-bit FNV-1a, seeded: two seeds give the 128-bit key of a cache entry
+inline uint64 fnv1a ( const std::string &s, uint64 h ) {
+	for ( size_t i = 0 ; i < s.size() ; i++ )
+		h = ( h ^ (unsigned char)s[i] ) * 0x100000001b3ULL ;
+	return h ;
+}
+
+// Value size of a cached column (0: variable length)
+inline uint32 cache_width ( const ColPlan &cp ) {
+	switch ( cp.kind ) {
+		case CK_NUMERIC:	return (uint32)( cp.size / 19 + 1 ) * sizeof(uint64) ;		// VNumeric words
+		case CK_STRING:
+		case CK_WSTRING:	return 0 ;
+		case CK_BOOL:		return 1 ;
+		default:			return sizeof(uint64) ;
+	}
+}
+
+// A cache file mapped in memory, validated once when opened
+class CacheFile
+{
+	void *base = MAP_FAILED ;
+	size_t len = 0 ;
+
+public:
+	const CacheHead *head = 0 ;
+	const CacheCol *cols = 0 ;
+
+	~CacheFile () {
+		if ( base != MAP_FAILED )
+			munmap(base, len) ;
+	}
+
+	const char *at ( uint64 off ) const { return (const char *)base + off ; }
+	bool isNull ( unsigned int j, uint64 i ) const { return at(cols[j].nulls)[i >> 3] & ( 1 << ( i & 7 ) ) ; }
+
+	// Map "path" if it holds the entry "hash", younger than "ttl" seconds:
+	bool open ( const std::string &path, const uint64 hash[2], int64 ttl ) {
+		int fd = ::open(path.c_str(), O_RDONLY) ;
+		struct stat st ;
+		if ( fd < 0 )
+			return false ;
+		if ( fstat(fd, &st) || (size_t)st.st_size < sizeof(CacheHead) ) {
+			close(fd) ;
+			return false ;
+		}
+		len = (size_t)st.st_size ;
+		base = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0) ;
+		close(fd) ;
+		if ( base == MAP_FAILED )
+			return false ;
+		head = (const CacheHead *)base ;
+		if ( memcmp(head->magic, CACHE_MAGIC, sizeof(head->magic)) || head->size != len ||
+				head->hash[0] != hash[0] || head->hash[1] != hash[1] || head->created + ttl <= (int64)time(NULL) ||
+				sizeof(CacheHead) + (uint64)head->ncol * sizeof(CacheCol) > len )
+			return false ;
+		cols = (const CacheCol *)at(sizeof(CacheHead)) ;
+		for ( uint32 j = 0 ; j < head->ncol ; j++ ) {
+			const CacheCol &c = cols[j] ;
+			uint64 vals = c.width ? c.width * head->rows : ( head->rows + 1 ) * sizeof(uint64) ;
+			if ( c.name + c.namelen > len || c.nulls + ( head->rows + 7 ) / 8 > len || c.data + vals > len ||
+					( !c.width && c.vars + ((const uint64 *)at(c.data))[head->rows] > len ) )
+				return false ;
+		}
+		(void)utimensat(AT_FDCWD, path.c_str(), NULL, 0) ;		// LRU clock
+		return true ;
+	}
+} ;
+
+// Remove the least recently used entries of "dir" until it fits in "max" bytes:
+void cache_evict ( const std::string &dir, uint64 max ) {
+	std::vector<std::pair<std::pair<time_t, long>, std::string> > files ;
+	uint64 total = 0 ;
+	DIR *d = opendir(dir.c_str()) ;
+	struct dirent *e ;
+	struct stat st ;
+
+	if ( !d )
+		return ;
+	while ( ( e = readdir(d) ) ) {
+		std::string name = e->d_name ;
+		if ( name.size() < 4 || name.compare(name.size() - 4, 4, ".dbc") || stat(( dir + "/" + name ).c_str(), &st) )
+			continue ;
+		files.push_back(std::make_pair(std::make_pair(st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec), dir + "/" + name)) ;
+		total += (uint64)st.st_size ;
+	}
+	closedir(d) ;
+	std::sort(files.begin(), files.end()) ;
+	for ( size_t i = 0 ; i < files.size() && total > max ; i++ ) {
+		if ( !stat(files[i].second.c_str(), &st) && !unlink(files[i].second.c_str()) )
+			total -= std::min(total, (uint64)st.st_size) ;
+	}
+}
+
+// Output writer recording the values written to a PartitionWriter, column by column, to save
+// them in the cache once the result set is complete. Gives up (and frees its buffers) past
+// "max" bytes.
+class CacheWriter
+{
+	PartitionWriter &out ;
+	const std::vector<ColPlan> &plan ;
+	const SizedColumnTypes &types ;
+	std::vector<uint32> width ;
+	std::vector<std::vector<uint8_t> > nulls ;
+	std::vector<std::vector<char> > data ;
+	std::vector<std::vector<char> > vars ;
+	std::vector<uint64> slot ;				// Fixed size values of the current row
+	std::vector<bool> isnull ;				// NULLs of the current row
+	uint64 rows = 0 ;
+	size_t bytes = 0 ;
+	size_t max ;
+
+public:
+	bool full = false ;
+
+	CacheWriter ( PartitionWriter &w, const std::vector<ColPlan> &p, const SizedColumnTypes &t, size_t m ) :
+			out(w), plan(p), types(t), nulls(p.size()), data(p.size()), vars(p.size()), slot(p.size(), 0),
+			isnull(p.size(), false), max(m) {
+		for ( size_t j = 0 ; j < plan.size() ; j++ ) {
+			width.push_back(cache_width(plan[j])) ;
+			if ( !width[j] )
+				data[j].resize(sizeof(uint64), 0) ;		// first string offset
+		}
+	}
+
+	void setNull ( size_t j ) { out.setNull(j) ; isnull[j] = true ; }
+	void setInt ( size_t j, vint v ) { out.setInt(j, v) ; slot[j] = (uint64)v ; }
+	void setFloat ( size_t j, vfloat v ) { out.setFloat(j, v) ; memcpy(&slot[j], &v, sizeof(v)) ; }
+	void setBool ( size_t j, vbool v ) { out.setBool(j, v) ; slot[j] = v ; }
+	void setDate ( size_t j, DateADT v ) { out.setDate(j, v) ; slot[j] = (uint64)v ; }
+	void setTime ( size_t j, TimeADT v ) { out.setTime(j, v) ; slot[j] = (uint64)v ; }
+	void setTimestamp ( size_t j, Timestamp v ) { out.setTimestamp(j, v) ; slot[j] = (uint64)v ; }
+	void setTimestampTz ( size_t j, TimestampTz v ) { out.setTimestampTz(j, v) ; slot[j] = (uint64)v ; }
+	void setInterval ( size_t j, Interval v ) { out.setInterval(j, v) ; slot[j] = (uint64)v ; }
+	VString &getStringRef ( size_t j ) { return out.getStringRef(j) ; }
+	VNumeric &getNumericRef ( size_t j ) { return out.getNumericRef(j) ; }
+
+	// End of row: strings and numerics are read back from the output writer
+	bool next () {
+		if ( !full ) {
+			for ( size_t j = 0 ; j < plan.size() ; j++ ) {
+				if ( rows % 8 == 0 )
+					nulls[j].push_back(0) ;
+				if ( isnull[j] )
+					nulls[j].back() |= (uint8_t)( 1 << ( rows % 8 ) ) ;
+				if ( width[j] == 0 ) {
+					if ( !isnull[j] ) {
+						const VString &vs = out.getStringRef(j) ;
+						vars[j].insert(vars[j].end(), vs.data(), vs.data() + vs.length()) ;
+						bytes += vs.length() ;
+					}
+					uint64 o = vars[j].size() ;
+					data[j].insert(data[j].end(), (const char *)&o, (const char *)&o + sizeof(o)) ;
+				} else if ( plan[j].kind == CK_NUMERIC ) {
+					const VNumeric &vn = out.getNumericRef(j) ;
+					if ( isnull[j] || (uint32)vn.nwds * sizeof(uint64) != width[j] )
+						data[j].resize(data[j].size() + width[j], 0) ;
+					else
+						data[j].insert(data[j].end(), (const char *)vn.words, (const char *)vn.words + width[j]) ;
+				} else {
+					data[j].insert(data[j].end(), (const char *)&slot[j], (const char *)&slot[j] + width[j]) ;
+				}
+				bytes += width[j] + sizeof(uint64) ;
+				isnull[j] = false ;
+			}
+			rows++ ;
+			if ( bytes > max ) {
+				full = true ;
+				std::vector<std::vector<char> >().swap(data) ;
+				std::vector<std::vector<char> >().swap(vars) ;
+				std::vector<std::vector<uint8_t> >().swap(nulls) ;
+			}
+		} else {
+			std::fill(isnull.begin(), isnull.end(), false) ;
+		}
+		return out.next() ;
+	}
+
+	// Write the cache file: a temporary file renamed over "path", so readers never see a
+	// partial one. Returns false on I/O errors.
+	bool save ( const std::string &path, const uint64 hash[2] ) {
+		if ( full )
+			return false ;
+		std::vector<CacheCol> cols(plan.size()) ;
+		CacheHead h ;
+		uint64 off = sizeof(CacheHead) + ALIGN8(plan.size() * sizeof(CacheCol)) ;
+		memset(&h, 0, sizeof(h)) ;
+		memset(cols.data(), 0, cols.size() * sizeof(CacheCol)) ;
+		for ( size_t j = 0 ; j < plan.size() ; j++ ) {
+			cols[j].sqlt = plan[j].sqlt ;
+			cols[j].decimals = plan[j].decimals ;
+			cols[j].kind = plan[j].kind ;
+			cols[j].size = plan[j].size ;
+			cols[j].width = width[j] ;
+			cols[j].namelen = (uint32)types.getColumnName(j).size() ;
+			cols[j].name = off ;
+			off += ALIGN8(cols[j].namelen) ;
+		}
+		for ( size_t j = 0 ; j < plan.size() ; j++ ) {
+			cols[j].nulls = off ;
+			off += ALIGN8(nulls[j].size()) ;
+			cols[j].data = off ;
+			off += ALIGN8(data[j].size()) ;
+			cols[j].vars = off ;
+			off += ALIGN8(vars[j].size()) ;
+		}
+		memcpy(h.magic, CACHE_MAGIC, sizeof(h.magic)) ;
+		h.hash[0] = hash[0] ;
+		h.hash[1] = hash[1] ;
+		h.created = (int64)time(NULL) ;
+		h.rows = rows ;
+		h.ncol = (uint32)plan.size() ;
+		h.size = off ;
+
+		std::string tmp = path + "." + std::to_string((long long)getpid()) + "." +
+			std::to_string((unsigned long long)std::hash<std::thread::id>()(std::this_thread::get_id())) ;
+		int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600) ;
+		FILE *f = fd < 0 ? NULL : fdopen(fd, "w") ;
+		static const char pad[8] = { 0 } ;
+		bool ok = f != NULL ;
+		auto put = [&] ( const void *p, size_t n ) {
+			ok = ok && fwrite(p, 1, n, f) == n && fwrite(pad, 1, ALIGN8(n) - n, f) == ALIGN8(n) - n ;
+		} ;
+		put(&h, sizeof(h)) ;
+		put(cols.data(), cols.size() * sizeof(CacheCol)) ;
+		for ( size_t j = 0 ; j < plan.size() ; j++ )
+			put(types.getColumnName(j).data(), cols[j].namelen) ;
+		for ( size_t j = 0 ; j < plan.size() ; j++ ) {
+			put(nulls[j].data(), nulls[j].size()) ;
+			put(data[j].data(), data[j].size()) ;
+			put(vars[j].data(), vars[j].size()) ;
+		}
+		if ( f )
+			ok = !fclose(f) && ok ;
+		else if ( fd >= 0 )
+			close(fd) ;
+		if ( !ok || rename(tmp.c_str(), path.c_str()) ) {
+			unlink(tmp.c_str()) ;
+			return false ;
+		}
+		return true ;
+	}
+} ;
+
+// Output writer producing the Vertica NATIVE binary load format (COPY ... NATIVE) for the
+// DBLinkSource COPY source. Values keep their in-memory representation, so the NATIVE parser
+// does no text conversion: 8 byte integers, floats, dates, times and timestamps, 1 byte
+// booleans, NUMERIC words, CHAR/BINARY padded to the column length and other strings prefixed
+// by a 4 byte length. Rows are appended to "out" and drained by the source.
+class NativeWriter
+{
+	// String slot of a column: values are copied in place, like VString::copy()
+	struct NativeString {
+		std::string val ;
+		void copy ( const char *s, vsize n ) { val.assign(s, n) ; }
+		void copy ( const std::string &s ) { val = s ; }
+	} ;
+
+	const std::vector<ColPlan> &plan ;
+	std::vector<int32> width ;				// NATIVE column widths, -1 for variable length
+	std::vector<uint64> slot ;				// Fixed size values of the current row
+	std::vector<std::vector<uint64> > words ;	// NUMERIC values of the current row...
+	std::vector<VNumeric> nums ;			// ...and their writers
+	std::vector<NativeString> strs ;		// Strings of the current row
+	std::vector<bool> isnull ;				// NULLs of the current row
+
+public:
+	std::string out ;						// Encoded rows not yet drained
+	size_t pos = 0 ;						// First byte of "out" not yet drained
+
+	NativeWriter ( const std::vector<ColPlan> &p ) : plan(p), slot(p.size(), 0), words(p.size()),
+			strs(p.size()), isnull(p.size(), false) {
+		uint32 hlen = 5 + 4 * (uint32)plan.size() ;
+		uint16 ver = 1, ncol = (uint16)plan.size() ;
+		for ( size_t j = 0 ; j < plan.size() ; j++ ) {
+			const ColPlan &cp = plan[j] ;
+			words[j].resize(cp.kind == CK_NUMERIC ? cp.size / 19 + 1 : 1, 0) ;
+			nums.push_back(VNumeric(words[j].data(), cp.kind == CK_NUMERIC ? (int32)cp.size : 1, cp.decimals)) ;
+			if ( cp.kind == CK_STRING || cp.kind == CK_WSTRING )
+				width.push_back( cp.sqlt == SQL_CHAR || cp.sqlt == SQL_WCHAR || cp.sqlt == SQL_BINARY ? (int32)cp.size : -1 ) ;
+			else
+				width.push_back((int32)cache_width(cp)) ;
+		}
+		out.assign("NATIVE\n\377\r\n\0", 11) ;
+		out.append((const char *)&hlen, 4) ;
+		out.append((const char *)&ver, 2) ;
+		out.push_back('\0') ;
+		out.append((const char *)&ncol, 2) ;
+		out.append((const char *)width.data(), 4 * width.size()) ;
+	}
+
+	void setNull ( size_t j ) { isnull[j] = true ; }
+	void setInt ( size_t j, vint v ) { slot[j] = (uint64)v ; }
+	void setFloat ( size_t j, vfloat v ) { memcpy(&slot[j], &v, sizeof(v)) ; }
+	void setBool ( size_t j, vbool v ) { slot[j] = v ; }
+	void setDate ( size_t j, DateADT v ) { slot[j] = (uint64)v ; }
+	void setTime ( size_t j, TimeADT v ) { slot[j] = (uint64)v ; }
+	void setTimestamp ( size_t j, Timestamp v ) { slot[j] = (uint64)v ; }
+	void setTimestampTz ( size_t j, TimestampTz v ) { slot[j] = (uint64)v ; }
+	void setInterval ( size_t j, Interval v ) { slot[j] = (uint64)v ; }
+	NativeString &getStringRef ( size_t j ) { return strs[j] ; }
+	VNumeric &getNumericRef ( size_t j ) { return nums[j] ; }
+
+	// End of row: row length (data only), NULL bits (first column in the most significant bit)
+	// and the non NULL values
+	bool next () {
+		size_t head = out.size(), nb = ( plan.size() + 7 ) / 8 ;
+		out.append(4 + nb, '\0') ;
+		for ( size_t j = 0 ; j < plan.size() ; j++ ) {
+			if ( isnull[j] ) {
+				out[head + 4 + j / 8] |= (char)( 0x80 >> ( j % 8 ) ) ;
+				isnull[j] = false ;
+				continue ;
+			}
+			if ( width[j] < 0 ) {
+				uint32 n = (uint32)strs[j].val.size() ;
+				out.append((const char *)&n, 4) ;
+				out.append(strs[j].val) ;
+			} else if ( plan[j].kind == CK_STRING || plan[j].kind == CK_WSTRING ) {
+				size_t n = std::min(strs[j].val.size(), (size_t)width[j]) ;
+				out.append(strs[j].val, 0, n) ;
+				out.append((size_t)width[j] - n, plan[j].sqlt == SQL_BINARY ? '\0' : ' ') ;
+			} else if ( plan[j].kind == CK_NUMERIC ) {
+				out.append((const char *)words[j].data(), (size_t)width[j]) ;
+			} else {
+				out.append((const char *)&slot[j], (size_t)width[j]) ;
+			}
+		}
+		uint32 len = (uint32)( out.size() - head - 4 - nb ) ;
+		memcpy(&out[head], &len, 4) ;
+		return true ;
+	}
+
+	// Move the pending bytes to "buf" (up to "size"). Returns the number of bytes moved.
+	size_t drain ( char *buf, size_t size ) {
+		size_t n = std::min(size, out.size() - pos) ;
+		memcpy(buf, out.data() + pos, n) ;
+		pos += n ;
+		if ( pos == out.size() ) {
+			out.clear() ;
+			pos = 0 ;
+		}
+		return n ;
+	}
+} ;
+
+// Watermark state store (watermark_column). One file per connection/query/column holding the
+// highest watermark column value returned by the last successful call, as the text of an ODBC
+// literal (bound as SQL_C_CHAR on the next call). Files are replaced atomically.
+bool wm_read ( const std::string &path, std::string &value ) {
+	std::ifstream f(path) ;
+
+	value.clear() ;
+	return f.is_open() && std::getline(f, value) && !value.empty() ;
+}
+
+// State file of "key" in the state directory (watermark_dir), with extension "ext"
+std::string state_path ( ParamReader &params, const std::string &key, const char *ext ) {
+	char name[48] ;
+
+	snprintf(name, sizeof(name), "/%016llx%016llx.%s", (unsigned long long)fnv1a(key, 0xcbf29ce484222325ULL),
+		(unsigned long long)fnv1a(key, 0x6c62272e07bb0142ULL), ext) ;
+	return params.getStringRef("watermark_dir").str() + name ;
+}
+
+// Replace the file "path" with "body" atomically (temporary file, fsync, rename)
+bool file_replace ( const std::string &path, const std::string &body ) {
+	std::string tmp = path + ".tmp" + std::to_string((long long)getpid()) ;
+	int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600) ;
+
+	if ( fd < 0 )
+		return false ;
+	bool ok = write(fd, body.data(), body.size()) == (ssize_t)body.size() && !fsync(fd) ;
+	ok = !close(fd) && ok ;
+	if ( !ok || rename(tmp.c_str(), path.c_str()) ) {
+		unlink(tmp.c_str()) ;
+		return false ;
+	}
+	return true ;
+}
+
+bool wm_write ( const std::string &path, const std::string &value, const std::string &col, const std::string &query ) {
+	return file_replace(path, value + "\n-- " + col + "\n" + query + "\n") ;
+}
+
+// Description of a DBLINK call (remote query, connection and result set plan). Built by
+// describe() and never modified afterwards: the DBLink instances running the call share it
+// read only, so concurrent DBLINK calls (in one query or in one process) share no mutable
+// state. The connection and the statement prepared while describing are handed over to the
+// first instance asking for them; the other instances get a connection from the registry.
+struct Context
+{
+	std::string query ;				// Remote query
+	std::string connstr ;			// ODBC connection string
+	const Profile *profile = NULL ;	// Streaming profile (streaming param), NULL if off
+	bool is_select = false ;		// Command is a SELECT
+	Modes mode = MODE_QUERY ;		// mode param
+	SQLSMALLINT npar = 0 ;			// Number of parameter markers (sink mode)
+	bool pooling = true ;			// Return connections to the pool (pool param)
+	std::string split_col ;			// Split column name (parallel extraction), empty if not splitting
+	std::vector<std::string> split_cuts ;	// Split boundaries: N cuts define N+1 slices
+	std::vector<std::string> shards ;	// Shard CIDs (cid list or pattern), empty if not sharded...
+	std::vector<std::string> shard_cs ;	// ...and their connection strings (the first one is connstr)
+	std::vector<Admission> admits ;	// Admission limits of the CID (or of each shard), empty without CID
+	bool shard_col = false ;		// Shard CID returned as last column (shard_column param)
+	std::string wm_col ;			// Watermark column (incremental extraction), empty if none...
+	int wm_idx = -1 ;				// ...its result set column
+	std::string wm_path ;			// ...its state file
+	std::string wm_value ;			// ...and the last watermark (rows above it), empty on the first call
+	size_t chunk_rows = 0 ;			// Chunked extraction: rows per chunk, 0 if not chunking. The chunk
+									// key column is wm_col/wm_idx
+	std::vector<std::string> script ;	// Script mode statements...
+	std::vector<bool> script_rep ;	// ...repeated in the script (prepared once)
+	SQLUSMALLINT Oncol = 0 ;		// Number of result set columns
+	SizedColumnTypes colInfo ;		// Result set Vertica types
+	std::vector<ColPlan> Oplan ;	// Result set column plans
+	std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now() ;
+	Stats stats ;					// Describe phases
+	std::shared_ptr<CacheFile> cache ;	// Result set served from the local cache (no connection)...
+	std::string cache_path ;		// ...or cache file to write (cache_ttl), empty if not caching
+	std::string cache_dir ;			// cache_dir param
+	uint64 cache_hash[2] = { 0, 0 } ;	// Cache key hashes
+	uint64 cache_max = 0 ;			// cache_max_mb param, bytes
+
+	std::mutex mtx ;
+	SQLHDBC Ocon = 0 ;				// Connection used to describe the query...
+	SQLHSTMT Ost = 0 ;				// ...and its statement (prepared for SELECTs), until handed over
+
+	~Context () {
+		release() ;
+	}
+
+	// Admission limit of the CID of shard "k" (0 without shards), NULL if not limited
+	const Admission *admission ( size_t k ) const {
+		return k < admits.size() && admits[k].max ? &admits[k] : NULL ;
+	}
+
+	// Hand over the describe connection and statement (once):
+	bool take ( SQLHDBC &con, SQLHSTMT &st ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		if ( !Ocon )
+			return false ;
+		con = Ocon ;
+		st = Ost ;
+		Ocon = 0 ;
+		Ost = 0 ;
+		return true ;
+	}
+
+	// Give back the describe connection if nobody took it:
+	void release () {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		if ( Ost ) {
+			(void)SQLFreeHandle(SQL_HANDLE_STMT, Ost);
+			Ost = 0 ;
+		}
+		if ( Ocon ) {
+			registry.release(connstr, Ocon, pooling) ;
+			Ocon = 0 ;
+		}
+	}
+
+	// Query extracting the split column values from "lo" (included) to "hi" (excluded). An empty
+	// "lo" also gets the NULL keys, an empty "hi" is open ended.
+	std::string range_query ( const std::string &lo, const std::string &hi ) const {
+		std::string q = "SELECT * FROM (" + query + ") dblink_s" ;
+
+		if ( lo.empty() && hi.empty() )
+			return q ;
+		if ( lo.empty() )
+			q += " WHERE " + split_col + " < " + hi + " OR " + split_col + " IS NULL" ;
+		else if ( hi.empty() )
+			q += " WHERE " + split_col + " >= " + lo ;
+		else
+			q += " WHERE " + split_col + " >= " + lo + " AND " + split_col + " < " + hi ;
+		return q ;
+	}
+
+	// Query extracting slice "s" of the split column range. N cuts define N+1 slices:
+	// the first one also gets the NULL keys, the last one is open ended.
+	std::string split_query ( size_t s ) const {
+		return range_query(s ? split_cuts[s - 1] : "", s < split_cuts.size() ? split_cuts[s] : "") ;
+	}
+
+	// Zero-row version of the query, described instead of it: drivers describing a query by
+	// running it (MySQL, psqlODBC without server side prepare...) then return no rows
+	std::string zero_query ( DBs dbt ) const {
+		std::string q = query ;
+
+		q.erase(q.find_last_not_of(" \n\t\r;") + 1) ;
+		if ( dbt == POSTGRES || dbt == VERTICA || dbt == MYSQL )
+			return "SELECT * FROM (" + q + ") dblink_z LIMIT 0" ;
+		if ( dbt == SQLSERVER )
+			return "SELECT TOP 0 * FROM (" + q + ") dblink_z" ;
+		return "SELECT * FROM (" + q + ") dblink_z WHERE 1=0" ;
+	}
+
+	// Chunked extraction: query returning the next "chunk_rows" rows ordered on the chunk column,
+	// from the beginning ("first") or above the last key returned (bound parameter)
+	std::string chunk_query ( DBs dbt, bool first ) const {
+		std::string n = std::to_string((unsigned long long)chunk_rows) ;
+		std::string q = "SELECT " ;
+
+		if ( dbt == SQLSERVER || dbt == TERADATA )
+			q += "TOP " + n + " " ;
+		q += "* FROM (" + query + ") dblink_c WHERE " + wm_col + ( first ? " IS NOT NULL" : " > ?" ) + " ORDER BY " + wm_col ;
+		if ( dbt == POSTGRES || dbt == VERTICA || dbt == MYSQL )
+			q += " LIMIT " + n ;
+		else if ( dbt == ORACLE || dbt == GENERIC )
+			q += " FETCH FIRST " + n + " ROWS ONLY" ;
+		return q ;
+	}
+
+	// Chunked extraction: the rows without key, fetched after the last chunk
+	std::string null_chunk_query () const {
+		return "SELECT * FROM (" + query + ") dblink_c WHERE " + wm_col + " IS NULL" ;
+	}
+} ;
+
+// Contexts built by the factory (getReturnType) waiting for their instances (setup), keyed by
+// the call parameters. Entries expire after POOL_IDLE_SECS; instances keep their own reference.
+class Contexts
+{
+	std::mutex mtx ;
+	std::map<std::string, std::shared_ptr<Context> > ctxs ;
+
+public:
+	void put ( const std::string &key, const std::shared_ptr<Context> &ctx ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now() ;
+		for ( std::map<std::string, std::shared_ptr<Context> >::iterator it = ctxs.begin() ; it != ctxs.end() ; ) {
+			if ( now - it->second->since > std::chrono::seconds(POOL_IDLE_SECS) )
+				it = ctxs.erase(it) ;
+			else
+				++it ;
+		}
+		ctxs[key] = ctx ;
+	}
+
+	// Contexts older than POOL_IDLE_SECS belong to an earlier call: removed, not returned
+	std::shared_ptr<Context> get ( const std::string &key ) {
+		std::lock_guard<std::mutex> lock(mtx) ;
+		std::map<std::string, std::shared_ptr<Context> >::iterator it = ctxs.find(key) ;
+		if ( it == ctxs.end() )
+			return std::shared_ptr<Context>() ;
+		if ( std::chrono::steady_clock::now() - it->second->since > std::chrono::seconds(POOL_IDLE_SECS) ) {
+			ctxs.erase(it) ;
+			return std::shared_ptr<Context>() ;
+		}
+		return it->second ;
+	}
+} ;
+Contexts contexts ;
+
+// Key of a DBLINK call: every parameter used to describe it or to plan its columns
+std::string context_key ( ServerInterface &srvInterface ) {
+	ParamReader params = srvInterface.getParamReader() ;
+	ParamReader sparams = srvInterface.getUDSessionParamReader("library") ;
+	std::string key ;
+	const char *sp[] = { "cid", "connect", "connect_secret", "cidfile", "query", "timestamptz", "split_column", "split_bounds", "mode", "cache_dir", "watermark_column", "watermark_dir", "streaming", "chunk_column", "shard_column" } ;
+	const char *ip[] = { "split_count", "cache_ttl", "cache_max_mb", "describe_ttl", "chunk_rows", "batch_size" } ;
+	const char *bp[] = { "pool", "wide_char", "describe_refresh", "numeric_native", "lob_stream" } ;
+
+	for ( size_t i = 0 ; i < sizeof(sp) / sizeof(sp[0]) ; i++ )
+		key += ( params.containsParameter(sp[i]) ? "=" + params.getStringRef(sp[i]).str() : "-" ) + '\x1f' ;
+	for ( size_t i = 0 ; i < sizeof(ip) / sizeof(ip[0]) ; i++ )
+		key += ( params.containsParameter(ip[i]) ? std::to_string((long long)params.getIntRef(ip[i])) : "-" ) + '\x1f' ;
+	for ( size_t i = 0 ; i < sizeof(bp) / sizeof(bp[0]) ; i++ )
+		key += params.containsParameter(bp[i]) ? ( params.getBoolRef(bp[i]) == VTrue ? "1" : "0" ) : "-" ;
+	key += '\x1f' ;
+	if ( sparams.containsParameter("dblink_secret") )
+		key += sparams.getStringRef("dblink_secret").str() ;
+	return key ;
+}
+
+std::shared_ptr<Context> describe ( ServerInterface &srvInterface, SizedColumnTypes &outputTypes, size_t ninput = 0,
+	const std::string &planned = std::string() ) ;
+
+// Shards: a CID of the call fetched by its own thread, connection and arena buffer. The
+// buffer is handed over to the UDx thread through "state":
+enum ShardStates {
+	SHARD_FETCHING = 0,		// owned by the fetching thread
+	SHARD_READY,			// "nfr" rows to convert, owned by the UDx thread
+	SHARD_DONE				// no more rows ("err" set on errors)
+};
+
+struct Shard
+{
+	size_t n = 0 ;					// Shard number (Context shards)
+	SQLHDBC con = 0 ;				// Own connection, 0 if using the instance one
+	std::atomic<SQLHSTMT> st { 0 } ;	// Statement (canceled by the UDx thread on errors)
+	SQLULEN off = 0 ;				// Bind offset of the shard buffer in the arena
+	SQLULEN nfr = 0 ;				// Rows fetched in the buffer
+	std::atomic<int> state { SHARD_FETCHING } ;
+	std::string err ;				// Error message of the fetching thread
+	double execute = 0 ;			// Timings and counters merged in the instance Stats
+	double fetch = 0 ;
+	double first_row = 0 ;
+	size_t fetches = 0 ;
+	double admit = 0 ;
+} ;
+
+class DBLink : public TransformFunction
+{
+	friend class DBLinkSource ;
+
+	std::shared_ptr<Context> ctx ;	// Description of the call (shared, read only)
+	SQLUSMALLINT Oncol ;   // Number of result set columns
+	bool Iprepared ;       // Ist is the statement prepared by describe()
+	DBs dbt ;
+	bool Ibigint ;		// The driver binds SQL_C_SBIGINT (type probe in setup)
+	SQLPOINTER *Ores ;     // result array pointers pointer
+	SQLLEN **Olen ;        // length array pointers pointer
+	ColPlan *Iplan ;       // column plans (instance copy)
+	unsigned int *Ikcols[CK_KINDS] ;	// columns of each conversion kind
+	unsigned int Iknum[CK_KINDS] ;		// number of columns of each conversion kind
+	bool *Inonull ;        // column has no NULLs in the current rowset
+	uint32_t *Idkey ;      // last converted date of each column (y/m/d key)...
+	DateADT *Idval ;       // ...and its DateADT
+	int64 Itzoff ;         // UTC offset of remote timestamps (timestamptz param), microseconds
+	StringParsers parser ;
+	size_t rowset ;		// Fetch rowset (buffers size, in rows)
+	size_t Iarray ;		// Current SQL_ATTR_ROW_ARRAY_SIZE (<= rowset)
+	size_t Ifetchmb ;	// Fetch buffers budget in MB (fetch_buffer_mb), 0 if rowset is fixed
+	bool Iadapt ;		// Adaptive array size (rowset_adaptive)
+	SQLHDBC Icon ;		// Instance ODBC Connection handle
+	SQLHSTMT Ist ;		// Statement handle used by this instance
+	SQLULEN nfr ;		// Number of fetched rows
+	size_t nbuf ;		// Number of rowset buffers (pipeline)
+	size_t Oarena ;		// Size of one rowset buffer (all columns)
+	size_t Ocopies ;	// Rowset buffers allocated in the arena (0 before the first partition)
+	SQLULEN Ooff ;		// Bind offset of the rowset buffer being fetched
+	SQLULEN Pnfr[MAX_PIPELINE] ;	// Number of rows in each pipeline buffer
+	std::atomic<size_t> Phead ;		// Rowsets fetched by the producer thread
+	std::atomic<size_t> Ptail ;		// Rowsets converted by the UDx thread
+	std::atomic<bool> Pstop ;		// Consumer asks the producer to stop
+	std::atomic<bool> Pdone ;		// Producer is done (Pret is valid)
+	SQLRETURN Pret ;				// Last producer SQLFetchScroll return code
+	bool Ilobs ;					// Stream long columns with SQLGetData (lob_stream)
+	bool Inumnative ;				// Bind NUMERIC columns as SQL_C_NUMERIC (numeric_native)
+	SQLUINTEGER Igdext ;			// SQL_GETDATA_EXTENSIONS of the remote driver
+	std::vector<char> Ilob ;		// Scratch buffer for streamed columns
+	std::vector<char> Iwide ;		// Scratch buffer for wide columns transcoded to UTF-8
+	Stats St ;						// Timings and counters of the current partition
+	std::chrono::steady_clock::time_point Texec ;	// Start of the last execution
+	std::string Istatsfile ;		// Stats are appended here too (stats_file)
+	bool Iasync ;					// Execute asynchronously, polling for cancel (async, SQL_AM_STATEMENT drivers)
+	size_t Itimeout ;				// Remote execution timeout in seconds (query_timeout), 0 if none
+	size_t Itrunc ;					// Streamed or wide values truncated to the Vertica column length
+	unsigned int Incol ;			// Sink mode: number of input columns (parameters)...
+	ColPlan *Ipar ;					// ...their plans
+	SQLPOINTER *Pbuf ;				// Parameter arrays
+	SQLLEN **Plen ;					// Parameter length/indicator arrays
+	size_t Ibatch ;					// Rows per SQLExecute (parameter set size)
+	size_t Icommit ;				// Commit every Icommit batches (0: at the end of each partition)
+	bool Itx ;						// Script mode: one transaction for the whole script (transaction)
+	std::map<std::string, SQLHSTMT> Iprep ;	// Script mode: repeated statements, prepared once
+	SQLULEN Pproc ;					// Parameter sets processed by the last SQLExecute...
+	SQLUSMALLINT *Pstat ;			// ...and the status of each one (Ibatch entries)
+	std::unordered_set<std::string> Iseen ;	// Lookup mode: keys already sent (current partition)
+	const std::string *Ishard ;		// Shards: CID written in the shard column (NULL if none)
+	std::atomic<bool> Sstop ;		// Shards: the UDx thread asks the fetching threads to stop
+	std::atomic<bool> Icancel ;		// cancel() was called (COPY sources: isCanceled() never fires)
+	std::string Iplanned ;			// COPY sources: description and split of the factory plan()
+	int Iwm ;						// Watermark column index (watermark_column), -1 if none
+	bool Iwmset ;					// Watermark: some non NULL value seen...
+	int64 Iwmk[2] ;					// ...its ordering key (integer or packed date/time, fraction)...
+	std::string Iwmraw ;			// ...and its bound value (string, or element bytes)
+	SQLLEN Iwmlen ;					// Watermark parameter length/indicator
+	size_t Iretries ;				// Chunked extraction: retries of a failed chunk (chunk_retries)
+
+	// Canceled by Vertica: through the transform (isCanceled) or forwarded by the COPY source
+	bool canceled()
+	{
+		return Icancel.load(std::memory_order_acquire) || isCanceled() ;
+	}
+
+	// Incremental extraction: keep the highest watermark column value of the "Onr" rows of the
+	// rowset buffer at offset "off". Dates and timestamps are ordered by their packed fields.
+	// Character chunk keys come in the remote order: the last one is the highest.
+	void trackWatermark(size_t off, SQLULEN Onr)
+	{
+		const ColPlan &cp = Iplan[Iwm] ;
+		const SQLLEN *Ol = (const SQLLEN *)((uint8_t *)Olen[Iwm] + off) ;
+		const char *Od = (const char *)Ores[Iwm] + off ;
+
+		for ( SQLULEN i = 0 ; i < Onr ; i++ ) {
+			const char *v = Od + cp.desz * i ;
+			int64 k[2] = { 0, 0 } ;
+			if ( Ol[i] == SQL_NULL_DATA )
+				continue ;
+			switch ( cp.kind ) {
+				case CK_INT:
+				case CK_NUMERIC_INT:
+					k[0] = *(const SQLBIGINT *)v ;
+					break ;
+				case CK_INT_CHAR:
+				case CK_NUMERIC:
+					if ( !*v )
+						continue ;
+					k[0] = strtoll(v, NULL, 10) ;
+					break ;
+				case CK_NUMERIC_STRUCT:
+					{
+						const SQL_NUMERIC_STRUCT &sn = *(const SQL_NUMERIC_STRUCT *)v ;
+						uint64 mag = 0 ;
+						for ( int b = 8 ; b-- > 0 ; )		// little endian magnitude, precision <= 18
+							mag = mag << 8 | sn.val[b] ;
+						k[0] = sn.sign ? (int64)mag : -(int64)mag ;
+						break ;
+					}
+				case CK_DATE:
+					{
+						const SQL_DATE_STRUCT &d = *(const SQL_DATE_STRUCT *)v ;
+						k[0] = ( (int64)d.year * 100 + d.month ) * 100 + d.day ;
+						break ;
+					}
+				case CK_TIMESTAMP:
+				case CK_TIMESTAMPTZ:
+					{
+						const SQL_TIMESTAMP_STRUCT &ts = *(const SQL_TIMESTAMP_STRUCT *)v ;
+						k[0] = ( ( ( ( (int64)ts.year * 100 + ts.month ) * 100 + ts.day ) * 100 + ts.hour ) * 100 + ts.minute ) * 100 + ts.second ;
+						k[1] = ts.fraction ;
+						break ;
+					}
+				case CK_STRING:
+					{
+						size_t len = ( Ol[i] < 0 || (size_t)Ol[i] >= cp.desz ) ? strnlen(v, cp.desz - 1) : (size_t)Ol[i] ;
+						Iwmraw.assign(v, len) ;
+						Iwmset = true ;
+						continue ;
+					}
+				default:
+					continue ;
+			}
+			if ( !Iwmset || k[0] > Iwmk[0] || ( k[0] == Iwmk[0] && k[1] > Iwmk[1] ) ) {
+				Iwmk[0] = k[0] ;
+				Iwmk[1] = k[1] ;
+				Iwmraw.assign(v, cp.desz) ;
+				Iwmset = true ;
+			}
+		}
+	}
+
+	// The highest watermark value seen, as text for the next call parameter
+	std::string watermarkText() const
+	{
+		const ColPlan &cp = Iplan[Iwm] ;
+		char buf[64] ;
+		switch ( cp.kind ) {
+			case CK_STRING:
+				return Iwmraw ;
+			case CK_DATE:
+				{
+					const SQL_DATE_STRUCT &d = *(const SQL_DATE_STRUCT *)Iwmraw.data() ;
+					snprintf(buf, sizeof(buf), "%04d-%02u-%02u", (int)d.year, (unsigned)d.month, (unsigned)d.day) ;
+					return buf ;
+				}
+			case CK_TIMESTAMP:
+			case CK_TIMESTAMPTZ:
+				{
+					const SQL_TIMESTAMP_STRUCT &ts = *(const SQL_TIMESTAMP_STRUCT *)Iwmraw.data() ;
+					int digits = std::min(std::max((int)cp.decimals, 0), 9) ;
+					SQLUINTEGER frac = ts.fraction ;
+					int n = snprintf(buf, sizeof(buf), "%04d-%02u-%02u %02u:%02u:%02u", (int)ts.year, (unsigned)ts.month,
+						(unsigned)ts.day, (unsigned)ts.hour, (unsigned)ts.minute, (unsigned)ts.second) ;
+					for ( int d = digits ; d < 9 ; d++ )
+						frac /= 10 ;
+					if ( digits )
+						snprintf(buf + n, sizeof(buf) - n, ".%0*u", digits, (unsigned)frac) ;
+					return buf ;
+				}
+			default:
+				return std::to_string((long long)Iwmk[0]) ;
+		}
+	}
+
+	// Convert the "Onr" rows of the rowset buffer at offset "off" of the arena. Columns are
+	// processed grouped by conversion kind, so each group runs a tight loop with no type switch.
+	// NULLs are scanned column by column first: columns without NULLs skip the per-cell test.
+	template <class W>
+	void convertRowset(W &outputWriter, size_t off, SQLULEN Onr)
+	{
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+		if ( Iwm >= 0 )
+			trackWatermark(off, Onr) ;
+		for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
+			if ( Iplan[j].kind == CK_LOB )
+				continue ;
+			const SQLLEN *Ol = (const SQLLEN *)((uint8_t *)Olen[j] + off) ;
+			int nulls = 0 ;
+			SQLLEN bytes = 0 ;
+			for ( SQLULEN i = 0 ; i < Onr ; i++ ) {
+				nulls |= ( (int)Ol[i] == (int)SQL_NULL_DATA ) ;
+				bytes += std::max(Ol[i], (SQLLEN)0) ;
+			}
+			Inonull[j] = !nulls ;
+			St.bytes += (size_t)bytes ;
+		}
+
+		for ( SQLULEN i = 0 ; i < Onr ; i++, outputWriter.next() ) {
+			convertKind<CK_INT>(outputWriter, off, i) ;
+			convertKind<CK_FLOAT>(outputWriter, off, i) ;
+			convertKind<CK_STRING>(outputWriter, off, i) ;
+			convertKind<CK_WSTRING>(outputWriter, off, i) ;
+			convertKind<CK_NUMERIC>(outputWriter, off, i) ;
+			convertKind<CK_NUMERIC_STRUCT>(outputWriter, off, i) ;
+			convertKind<CK_NUMERIC_INT>(outputWriter, off, i) ;
+			convertKind<CK_DATE>(outputWriter, off, i) ;
+			convertKind<CK_TIMESTAMP>(outputWriter, off, i) ;
+			convertKind<CK_TIMESTAMPTZ>(outputWriter, off, i) ;
+			convertKind<CK_TIME>(outputWriter, off, i) ;
+			convertKind<CK_BOOL>(outputWriter, off, i) ;
+			convertKind<CK_INT_CHAR>(outputWriter, off, i) ;
+			convertKind<CK_INTERVAL_YM>(outputWriter, off, i) ;
+			convertKind<CK_INTERVAL_DS>(outputWriter, off, i) ;
+			if ( Iknum[CK_LOB] )
+				streamLobs(outputWriter, i) ;
+			if ( Ishard )
+				outputWriter.getStringRef(Oncol).copy(*Ishard) ;
+		}
+		St.rows += Onr ;
+		St.convert += secs_since(t0) ;
+	}
+
+	// Read the unbound (CK_LOB) columns of row "i" of the current rowset. Values are read in
+	// LOB_CHUNK pieces into a scratch buffer reused across rows, so memory follows the actual
+	// value size instead of the declared column length. Columns are read in ascending order.
+	// Wide columns (SQL_C_WCHAR) are transcoded to UTF-8 once read.
+	template <class W>
+	void streamLobs(W &outputWriter, SQLULEN i)
+	{
+		SQLRETURN Oret = 0 ;
+
+		if ( rowset > 1 && !SQL_SUCCEEDED(Oret=SQLSetPos(Ist, (SQLSETPOSIROW)(i + 1), SQL_POSITION, SQL_LOCK_NO_CHANGE)) ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 413, "Error positioning on row");
+		}
+		for ( unsigned int c = 0 ; c < Iknum[CK_LOB] ; c++ ) {
+			unsigned int j = Ikcols[CK_LOB][c] ;
+			bool wide = Iplan[j].ctype == SQL_C_WCHAR ;
+			size_t term = ( Iplan[j].ctype == SQL_C_CHAR ) ? 1 : wide ? sizeof(SQLWCHAR) : 0 ;	// room for the NUL terminator
+			size_t maxv = (size_t)ctx->colInfo.getColumnType(j).getStringLength() ;
+			size_t maxl = wide ? maxv * sizeof(SQLWCHAR) : maxv ;	// UTF-16: a unit is at least one UTF-8 byte
+			size_t got = 0 ;
+			SQLLEN Oind = 0 ;
+
+			for ( ;; ) {
+				if ( Ilob.size() < got + LOB_CHUNK + term )
+					Ilob.resize(got + LOB_CHUNK + term) ;
+				Oret = SQLGetData(Ist, (SQLUSMALLINT)(j + 1), Iplan[j].ctype, &Ilob[got], (SQLLEN)(Ilob.size() - got), &Oind) ;
+				if ( Oret == SQL_NO_DATA )
+					break ;
+				if ( !SQL_SUCCEEDED(Oret) ) {
+					ex_err(SQL_HANDLE_STMT, Ist, 414, "Error reading long column data");
+				}
+				if ( Oind == SQL_NULL_DATA )
+					break ;
+				if ( Oret == SQL_SUCCESS ) {	// last piece
+					got += (size_t)Oind ;
+					break ;
+				}
+				size_t part = Ilob.size() - got - term ;	// truncated piece: the buffer is full
+				got += part ;
+				if ( got >= maxl )
+					break ;
+				if ( Oind != SQL_NO_TOTAL && (size_t)Oind > part )	// remaining length is known: one more call
+					Ilob.resize(got + std::min((size_t)Oind - part, maxl - got) + term) ;
+			}
+			if ( Oind == SQL_NULL_DATA ) {
+				outputWriter.setNull(j) ;
+			} else {
+				if ( got > maxl ) {
+					got = maxl ;
+					Itrunc++ ;
+				}
+				if ( wide ) {
+					size_t units = got / sizeof(SQLWCHAR), used = 0 ;
+					if ( Iwide.size() < std::min(units * 3, maxv) )
+						Iwide.resize(std::min(units * 3, maxv)) ;
+					size_t len = utf16_to_utf8((const SQLWCHAR *)Ilob.data(), units, Iwide.data(), maxv, &used) ;
+					if ( used < units )
+						Itrunc++ ;
+					outputWriter.getStringRef(j).copy(Iwide.data(), len) ;
+				} else {
+					outputWriter.getStringRef(j).copy(Ilob.data(), got) ;
+				}
+				St.bytes += got ;
+			}
+		}
+	}
+
+	// Convert row "i" of all columns of kind K (the switch is resolved at compile time):
+	template <int K, class W>
+	inline void convertKind(W &outputWriter, size_t off, SQLULEN i)
+	{
+		for ( unsigned int c = 0 ; c < Iknum[K] ; c++ ) {
+			unsigned int j = Ikcols[K][c] ;
+			SQLPOINTER Odp = (SQLPOINTER)((uint8_t *)Ores[j] + off + Iplan[j].desz * i) ;	// Data Element Pointer
+			SQLULEN    Odl = ((SQLLEN *)((uint8_t *)Olen[j] + off))[i] ;				// Data Element Length
+
+			if ( !Inonull[j] && (int)Odl == (int)SQL_NULL_DATA ) {
+				outputWriter.setNull(j) ;
+				continue ;
+			}
+			switch ( K ) {
+				case CK_INT:
+					outputWriter.setInt(j, *(SQLBIGINT *)Odp) ;
+					break ;
+				case CK_INT_CHAR:
+					{
+						vint v = vint_null ;
+						if ( (int)Odl != SQL_NTS && !parse_int64((char *)Odp, std::min((size_t)Odl, Iplan[j].desz - 1), v) ) {
+							ex_err(0, 0, 419, "Error parsing Integer");
+						}
+						outputWriter.setInt(j, v) ;
+						break ;
+					}
+				case CK_FLOAT:
+					outputWriter.setFloat(j, *(SQLDOUBLE *)Odp) ;
+					break ;
+				case CK_NUMERIC:
+					{
+						unsigned __int128 mag ;
+						bool neg ;
+						if ( *(char *)Odp == '\0' ) { // some DBs might use empty strings for NUMERIC nulls
+							outputWriter.setNull(j) ;
+							break ;
+						}
+						if ( (int)Odl == SQL_NTS || Odl >= Iplan[j].desz )
+							Odl = (SQLULEN)strnlen((char *)Odp, Iplan[j].desz) ;
+						if ( parse_decimal((char *)Odp, (size_t)Odl, numeric_precision(Iplan[j].size), Iplan[j].decimals, mag, neg) ) {
+							numeric_from_int128(outputWriter.getNumericRef(j), mag, neg) ;
+						} else {
+							std::string rejectReason = "Unrecognized remote database format" ;
+							if (!parser.parseNumeric((char*)Odp, (size_t)Odl, j,
+									outputWriter.getNumericRef(j), ctx->colInfo.getColumnType(j), rejectReason)) {
+								ex_err(0, 0, 404, "Error parsing Numeric");
+							}
+						}
+						break ;
+					}
+				case CK_NUMERIC_INT:
+					{
+						SQLBIGINT v = *(SQLBIGINT *)Odp ;
+						numeric_from_int128(outputWriter.getNumericRef(j), v < 0 ? 0 - (uint64)v : (uint64)v, v < 0) ;
+						break ;
+					}
+				case CK_NUMERIC_STRUCT:
+					{
+						SQL_NUMERIC_STRUCT &sn = *(SQL_NUMERIC_STRUCT *)Odp ;
+						unsigned __int128 mag = 0 ;
+						for ( int b = SQL_MAX_NUMERIC_LEN ; b-- > 0 ; )		// little endian magnitude
+							mag = mag << 8 | sn.val[b] ;
+						for ( int s = sn.scale ; s < Iplan[j].decimals ; s++ )
+							mag *= 10 ;
+						for ( int s = Iplan[j].decimals ; s < sn.scale ; s++ )
+							mag = ( mag + ( s + 1 == sn.scale ? 5 : 0 ) ) / 10 ;	// round half up on the last digit
+						if ( mag >= pow10_128(numeric_precision(Iplan[j].size)) ) {
+							ex_err(0, 0, 404, "Error parsing Numeric");
+						}
+						numeric_from_int128(outputWriter.getNumericRef(j), mag, sn.sign == 0 && mag) ;
+						break ;
+					}
+				case CK_STRING:
+					if ( (int)Odl == SQL_NTS )
+						Odl = (SQLULEN)strnlen((char *)Odp , Iplan[j].desz);
+					outputWriter.getStringRef(j).copy((char *)Odp, Odl ) ;
+					break ;
+				case CK_WSTRING:
+					{
+						size_t units = ( Iplan[j].desz / sizeof(SQLWCHAR) ) - 1, used ;
+						if ( (int)Odl != SQL_NTS && Odl / sizeof(SQLWCHAR) < units )
+							units = Odl / sizeof(SQLWCHAR) ;
+						else
+							for ( size_t u = 0 ; u < units ; u++ )
+								if ( !((SQLWCHAR *)Odp)[u] ) {
+									units = u ;
+									break ;
+								}
+						size_t len = utf16_to_utf8((SQLWCHAR *)Odp, units, Iwide.data(), Iplan[j].size, &used) ;
+						if ( used < units )
+							Itrunc++ ;
+						outputWriter.getStringRef(j).copy(Iwide.data(), len) ;
+						break ;
+					}
+				case CK_TIME:
+					{
+						SQL_TIME_STRUCT &st = *(SQL_TIME_STRUCT *)Odp ;
+						outputWriter.setTime(j, getTimeFromUnixTime(st.second + st.minute * 60 + st.hour * 3600 ) );
+						break ;
+					}
+				case CK_DATE:
+					{
+						SQL_DATE_STRUCT &sd = *(SQL_DATE_STRUCT *)Odp ;
+						outputWriter.setDate(j, cachedDate(j, sd.year, sd.month, sd.day) ) ;
+						break ;
+					}
+				case CK_TIMESTAMP:
+				case CK_TIMESTAMPTZ:
+					{
+						SQL_TIMESTAMP_STRUCT &ss = *(SQL_TIMESTAMP_STRUCT *)Odp ;
+						Timestamp ts = cachedDate(j, ss.year, ss.month, ss.day) * usPerDay
+							+ ss.hour * usPerHour + ss.minute * usPerMinute + ss.second * usPerSecond
+							+ ss.fraction / 1000 ;
+						if ( K == CK_TIMESTAMP )
+							outputWriter.setTimestamp(j, ts) ;
+						else
+							outputWriter.setTimestampTz(j, (TimestampTz)(ts - Itzoff)) ;
+						break ;
+					}
+				case CK_BOOL:
+					outputWriter.setBool(j, *(SQLCHAR *)Odp == SQL_TRUE ? VTrue : VFalse);
+					break ;
+				case CK_INTERVAL_YM: // Vertica stores these Intervals as durations in months
+					{
+						SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT*)Odp;
+						if (intv.interval_type != SQL_IS_YEAR_TO_MONTH) {
+							ex_err(0, 0, 405, "Unsupported INTERVAL data type. Expecting SQL_IS_YEAR_TO_MONTH");
+						}
+						Interval ret = (  (intv.intval.year_month.year*MONTHS_PER_YEAR)
+										+ (intv.intval.year_month.month))
+										* (intv.interval_sign == SQL_TRUE ? -1 : 1);
+						outputWriter.setInterval(j, ret);
+						break ;
+					}
+				case CK_INTERVAL_DS: // Vertica stores these Intervals as durations in microseconds
+					{
+						SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT*)Odp;
+						if (intv.interval_type != SQL_IS_DAY_TO_SECOND) {
+							ex_err(0, 0, 406, "Unsupported INTERVAL data type. Expecting SQL_IS_DAY_TO_SECOND");
+						}
+						
+						Interval ret = (  (intv.intval.day_second.day*usPerDay)
+										+ (intv.intval.day_second.hour*usPerHour)
+										+ (intv.intval.day_second.minute*usPerMinute)
+										+ (intv.intval.day_second.second*usPerSecond)
+										+ (intv.intval.day_second.fraction/1000))
+										* (intv.interval_sign == SQL_TRUE ? -1 : 1);
+						outputWriter.setInterval(j, ret);
+						break ;
+					}
+			}
+		}
+	}
+
+	// Date columns of fact tables repeat the same few days: remember the last one per column
+	inline DateADT cachedDate(unsigned int j, SQLSMALLINT y, SQLUSMALLINT m, SQLUSMALLINT d)
+	{
+		uint32_t key = ( (uint32_t)(uint16_t)y << 9 ) | ( (uint32_t)m << 5 ) | (uint32_t)d ;
+		if ( Idkey[j] != key ) {
+			Idkey[j] = key ;
+			Idval[j] = date_from_odbc(y, m, d) ;
+		}
+		return Idval[j] ;
+	}
+
+	// Per instance copy of the column plan, adjusted to the remote DBMS, and the list of
+	// columns of each conversion kind:
+	void buildPlan(ServerInterface &srvInterface)
+	{
+		if ( Iplan )		// planned on the first partition of the instance
+			return ;
+		Iplan = (ColPlan *)srvInterface.allocator->alloc(Oncol * sizeof(ColPlan)) ;
+		Inonull = (bool *)srvInterface.allocator->alloc(Oncol * sizeof(bool)) ;
+		Idkey = (uint32_t *)srvInterface.allocator->alloc(Oncol * sizeof(uint32_t)) ;
+		Idval = (DateADT *)srvInterface.allocator->alloc(Oncol * sizeof(DateADT)) ;
+		for ( int k = 0 ; k < CK_KINDS ; k++ ) {
+			Ikcols[k] = (unsigned int *)srvInterface.allocator->alloc(Oncol * sizeof(unsigned int)) ;
+			Iknum[k] = 0 ;
+		}
+		bool lobs = false, bound = false, anycol = true ;
+		for ( unsigned int j = Oncol ; j-- > 0 ; ) {
+			Iplan[j] = ctx->Oplan[j] ;
+			Idkey[j] = 0 ;		// no valid date has month 0
+			if ( !Ibigint && Iplan[j].kind == CK_INT )		// sign, 19 digits and terminator
+				Iplan[j].set(21, SQL_C_CHAR, CK_INT_CHAR) ;
+			if ( Ibigint && Iplan[j].kind == CK_NUMERIC && Iplan[j].size && Iplan[j].size <= 18 && Iplan[j].decimals == 0 )
+				Iplan[j].set(sizeof(SQLBIGINT), SQL_C_SBIGINT, CK_NUMERIC_INT) ;	// e.g. Oracle NUMBER(p)
+			if ( Inumnative && Iplan[j].kind == CK_NUMERIC && Iplan[j].size <= 38 && Iplan[j].decimals >= 0 )
+				Iplan[j].set(sizeof(SQL_NUMERIC_STRUCT), SQL_C_NUMERIC, CK_NUMERIC_STRUCT) ;
+			if ( Ilobs && ( Iplan[j].kind == CK_STRING || Iplan[j].kind == CK_WSTRING ) && Iplan[j].desz > LOB_STREAM_MIN ) {
+				Iplan[j].set(0, Iplan[j].ctype, CK_LOB) ;
+				anycol = anycol && !bound ;		// unbound column before a bound one
+				lobs = true ;
+			} else {
+				bound = true ;
+			}
+		}
+
+		// Hybrid binding needs SQLGetData on unbound columns preceding bound ones (SQL_GD_ANY_COLUMN),
+		// otherwise everything is bound. Without SQL_GD_BLOCK rows are fetched one at a time:
+		if ( lobs && !anycol && !( Igdext & SQL_GD_ANY_COLUMN ) ) {
+			srvInterface.log("DBLINK driver does not support SQL_GD_ANY_COLUMN: long columns are bound, not streamed");
+			for ( unsigned int j = 0 ; j < Oncol ; j++ )
+				if ( Iplan[j].kind == CK_LOB )
+					Iplan[j] = ctx->Oplan[j] ;
+		} else if ( lobs ) {
+			if ( rowset > 1 && !( Igdext & SQL_GD_BLOCK ) ) {
+				srvInterface.log("DBLINK driver does not support SQL_GD_BLOCK: streaming long columns with rowset=1");
+				rowset = 1 ;
+				Ifetchmb = 0 ;
+				Iadapt = false ;
+			}
+			nbuf = 1 ;		// SQLGetData runs on the fetching thread: no pipeline
+		}
+		for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
+			Ikcols[Iplan[j].kind][Iknum[Iplan[j].kind]++] = j ;
+			if ( Iplan[j].kind == CK_WSTRING && Iwide.size() < Iplan[j].size )
+				Iwide.resize(Iplan[j].size) ;
+		}
+	}
+
+	// SQL_C_NUMERIC uses the precision and scale of the application row descriptor, which
+	// SQLBindCol leaves to driver defaults (often scale 0). Setting them unbinds the record, so
+	// the data pointer is set last:
+	void bindNumeric(SQLHSTMT Oh, unsigned int j)
+	{
+		SQLRETURN Oret = 0 ;
+		SQLHDESC Oard = 0 ;
+
+		if (!SQL_SUCCEEDED(Oret=SQLGetStmtAttr(Oh, SQL_ATTR_APP_ROW_DESC, &Oard, 0, NULL)) ||
+				!SQL_SUCCEEDED(Oret=SQLSetDescField(Oard, (SQLSMALLINT)(j+1), SQL_DESC_TYPE, (SQLPOINTER)SQL_C_NUMERIC, 0)) ||
+				!SQL_SUCCEEDED(Oret=SQLSetDescField(Oard, (SQLSMALLINT)(j+1), SQL_DESC_PRECISION, (SQLPOINTER)(SQLLEN)Iplan[j].size, 0)) ||
+				!SQL_SUCCEEDED(Oret=SQLSetDescField(Oard, (SQLSMALLINT)(j+1), SQL_DESC_SCALE, (SQLPOINTER)(SQLLEN)Iplan[j].decimals, 0)) ||
+				!SQL_SUCCEEDED(Oret=SQLSetDescField(Oard, (SQLSMALLINT)(j+1), SQL_DESC_DATA_PTR, Ores[j], 0))) {
+			ex_err(SQL_HANDLE_STMT, Oh, 401, "Error binding NUMERIC column as SQL_C_NUMERIC");
+		}
+	}
+
+	// Allocate the result set buffers: "copies" arena buffers (pipeline buffers or shards) of
+	// "rowset" rows. With fetch_buffer_mb the rowset is sized on the bound row width. The UDx
+	// allocator only frees at the end of the instance: buffers are allocated on the first
+	// partition and kept for the next ones (again only if they need more copies).
+	void allocBuffers(ServerInterface &srvInterface, size_t copies)
+	{
+		if ( Ocopies >= copies )
+			return ;
+
+		// Allocate memory for Result Set and length array pointers:
+		if ( !Ocopies ) {
+			Ores = (SQLPOINTER *)srvInterface.allocator->alloc(Oncol * sizeof(SQLPOINTER)) ;
+			Olen = (SQLLEN **)srvInterface.allocator->alloc(Oncol * sizeof(SQLLEN *)) ;
+		}
+
+		// Byte budget: size the rowset on the bound row width (all buffers included)
+		if ( Ifetchmb ) {
+			size_t rowbytes = 0 ;
+			for ( unsigned int j = 0 ; j < Oncol ; j++ )
+				rowbytes += Iplan[j].desz + sizeof(SQLLEN) ;
+			rowset = ( Ifetchmb << 20 ) / copies / std::max(rowbytes, (size_t)1) ;
+			rowset = std::max((size_t)1, std::min(rowset, (size_t)MAX_BUDGET_ROWSET)) ;
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK fetch_buffer_mb=%zu row width=%zu bytes rowset=%zu", Ifetchmb, rowbytes, rowset);
+#endif
+		}
+		Iarray = Iadapt ? std::min(rowset, (size_t)DEF_ROWSET) : rowset ;
+
+		// Length and data arrays live in a single arena (one copy per buffer) so the active
+		// buffer is selected through SQL_ATTR_ROW_BIND_OFFSET_PTR:
+		Oarena = 0 ;
+		for ( unsigned int j = 0 ; j < Oncol ; j++ )
+			Oarena += ALIGN8(sizeof(SQLLEN) * rowset) + ALIGN8(Iplan[j].desz * rowset) ;
+		uint8_t *Obase = (uint8_t *)srvInterface.allocator->alloc(Oarena * copies) ;
+		for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
+			Olen[j] = (SQLLEN *)Obase ;
+			Obase += ALIGN8(sizeof(SQLLEN) * rowset) ;
+			Ores[j] = (SQLPOINTER)Obase ;
+			Obase += ALIGN8(Iplan[j].desz * rowset) ;
+		}
+		Ocopies = copies ;
+	}
+
+	// Bind the columns of statement "Oh" to the first arena buffer. "Ooffp" (the bind offset
+	// selecting the buffer) is NULL with a single buffer; "Onfrp" gets the rows fetched.
+	void bindColumns(SQLHSTMT Oh, SQLULEN *Ooffp, SQLULEN *Onfrp)
+	{
+		SQLRETURN Oret = 0 ;
+
+		for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
+			if ( Iplan[j].kind == CK_LOB )		// streamed with SQLGetData
+				continue ;
+			if (!SQL_SUCCEEDED(Oret=SQLBindCol(Oh, j+1, Iplan[j].ctype, Ores[j], Iplan[j].desz, Olen[j]))) {
+				ex_err(SQL_HANDLE_STMT, Oh, 401, "Error binding column");
+			}
+			if ( Iplan[j].kind == CK_NUMERIC_STRUCT )
+				bindNumeric(Oh, j) ;
+		}
+		// Set Statement attributes:
+		if (!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Oh, SQL_ATTR_ROW_BIND_TYPE, (SQLPOINTER)SQL_BIND_BY_COLUMN, 0))) {
+			ex_err(SQL_HANDLE_STMT, Oh, 402, "Error setting statement attribute SQL_ATTR_ROW_BIND_TYPE");
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Oh, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)Iarray, 0))) {
+			ex_err(SQL_HANDLE_STMT, Oh, 402, "Error setting statement attribute SQL_ATTR_ROW_ARRAY_SIZE");
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Oh, SQL_ATTR_ROWS_FETCHED_PTR, Onfrp, 0))) {
+			ex_err(SQL_HANDLE_STMT, Oh, 402, "Error setting statement attribute SQL_ATTR_ROWS_FETCHED_PTR");
+		}
+		if ( Ooffp && !SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Oh, SQL_ATTR_ROW_BIND_OFFSET_PTR, Ooffp, 0))) {
+			ex_err(SQL_HANDLE_STMT, Oh, 402, "Error setting statement attribute SQL_ATTR_ROW_BIND_OFFSET_PTR");
+		}
+	}
+
+	// Execute the prepared statement (query NULL) or "query" on Ist (or Oh), timed:
+	SQLRETURN timedExecute(const char *query)
+	{
+		return timedExecute(Ist, query) ;
+	}
+
+	SQLRETURN timedExecute(SQLHSTMT Oh, const char *query)
+	{
+		return endExecute(Oh, query, beginExecute(Oh, query)) ;
+	}
+
+	// Start the execution. Asynchronous executions return SQL_STILL_EXECUTING while the remote
+	// database works: the caller can do something else before waiting in endExecute().
+	SQLRETURN beginExecute(SQLHSTMT Oh, const char *query)
+	{
+		Texec = std::chrono::steady_clock::now() ;
+		if ( Iasync && !SQL_SUCCEEDED(SQLSetStmtAttr(Oh, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_ON, 0)) )
+			Iasync = false ;
+		return query ? SQLExecDirect(Oh, (SQLCHAR *)query, SQL_NTS) : SQLExecute(Oh) ;
+	}
+
+	// Wait for the execution, polling at growing intervals (up to ASYNC_POLL_MAX_US). A canceled
+	// call or an expired query_timeout cancels the remote statement. Fetches are synchronous.
+	SQLRETURN endExecute(SQLHSTMT Oh, const char *query, SQLRETURN Oret)
+	{
+		long us = ASYNC_POLL_MIN_US ;
+		bool stop = false, expired = false ;
+
+		while ( Oret == SQL_STILL_EXECUTING ) {
+			if ( !stop && ( canceled() || ( Itimeout && secs_since(Texec) > Itimeout ) ) ) {
+				stop = true ;
+				expired = !canceled() ;
+				(void)SQLCancel(Oh) ;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(us)) ;
+			us = std::min(us * 2, (long)ASYNC_POLL_MAX_US) ;
+			Oret = query ? SQLExecDirect(Oh, (SQLCHAR *)query, SQL_NTS) : SQLExecute(Oh) ;
+		}
+		St.execute += secs_since(Texec) ;
+		if ( Iasync )
+			(void)SQLSetStmtAttr(Oh, SQL_ATTR_ASYNC_ENABLE, (SQLPOINTER)SQL_ASYNC_ENABLE_OFF, 0) ;
+		if ( expired ) {
+			vt_report_error(421, "DBLINK. Remote execution canceled after query_timeout (%zu seconds)", Itimeout);
+		}
+		return Oret ;
+	}
+
+	// Write the rows of the local cache entry (cache hit), column values straight from the
+	// mapped file:
+	void replayCache(PartitionWriter &outputWriter)
+	{
+		const CacheFile &cf = *ctx->cache ;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+
+		for ( uint64 i = 0 ; i < cf.head->rows ; i++, outputWriter.next() ) {
+			if ( i % DEF_ROWSET == 0 && canceled() )
+				break ;
+			for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
+				const CacheCol &c = cf.cols[j] ;
+				const char *v = cf.at(c.data) + (uint64)c.width * i ;
+				int64 x = 0 ;
+
+				if ( cf.isNull(j, i) ) {
+					outputWriter.setNull(j) ;
+					continue ;
+				}
+				if ( c.width == sizeof(x) )
+					memcpy(&x, v, sizeof(x)) ;
+				switch ( ctx->Oplan[j].kind ) {
+					case CK_INT:
+						outputWriter.setInt(j, x) ;
+						break ;
+					case CK_FLOAT:
+						{
+							vfloat f ;
+							memcpy(&f, v, sizeof(f)) ;
+							outputWriter.setFloat(j, f) ;
+							break ;
+						}
+					case CK_NUMERIC:
+						{
+							VNumeric &vn = outputWriter.getNumericRef(j) ;
+							if ( (uint32)vn.nwds * sizeof(uint64) != c.width ) {
+								ex_err(0, 0, 420, "Cached NUMERIC size mismatch");
+							}
+							memcpy(vn.words, v, c.width) ;
+							break ;
+						}
+					case CK_STRING:
+					case CK_WSTRING:
+						{
+							uint64 o[2] ;
+							memcpy(o, cf.at(c.data) + i * sizeof(uint64), sizeof(o)) ;
+							outputWriter.getStringRef(j).copy(cf.at(c.vars) + o[0], (vsize)( o[1] - o[0] )) ;
+							St.bytes += o[1] - o[0] ;
+							break ;
+						}
+					case CK_TIME:
+						outputWriter.setTime(j, (TimeADT)x) ;
+						break ;
+					case CK_DATE:
+						outputWriter.setDate(j, (DateADT)x) ;
+						break ;
+					case CK_TIMESTAMP:
+						outputWriter.setTimestamp(j, (Timestamp)x) ;
+						break ;
+					case CK_TIMESTAMPTZ:
+						outputWriter.setTimestampTz(j, (TimestampTz)x) ;
+						break ;
+					case CK_BOOL:
+						outputWriter.setBool(j, *(const vbool *)v) ;
+						break ;
+					case CK_INTERVAL_YM:
+					case CK_INTERVAL_DS:
+						outputWriter.setInterval(j, (Interval)x) ;
+						break ;
+					default:
+						break ;
+				}
+				St.bytes += c.width ;
+			}
+			St.rows++ ;
+		}
+		St.convert += secs_since(t0) ;
+	}
+
+	// Save the result set recorded while fetching (cache miss) and evict old entries. Cache
+	// errors are logged, the call itself succeeded.
+	void saveCache(ServerInterface &srvInterface, CacheWriter &cacheWriter)
+	{
+		if ( canceled() )
+			return ;
+		if ( cacheWriter.full ) {
+			srvInterface.log("DBLINK result set larger than cache_max_mb: not cached") ;
+			return ;
+		}
+		mkdirs(ctx->cache_dir) ;
+		if ( !cacheWriter.save(ctx->cache_path, ctx->cache_hash) ) {
+			srvInterface.log("DBLINK cannot write the cache file <%s>", ctx->cache_path.c_str()) ;
+			return ;
+		}
+		cache_evict(ctx->cache_dir, ctx->cache_max) ;
+	}
+
+	// Incremental extraction: save the new watermark once the whole result set is fetched. A
+	// watermark that cannot be saved fails the call: the next one would extract the rows again
+	void saveWatermark(ServerInterface &srvInterface)
+	{
+		if ( canceled() || !Iwmset )
+			return ;
+		std::string value = watermarkText() ;
+		mkdirs(ctx->wm_path.substr(0, ctx->wm_path.rfind('/'))) ;
+		if ( !wm_write(ctx->wm_path, value, ctx->wm_col, ctx->query) ) {
+			vt_report_error(432, "DBLINK. Cannot write the watermark state file <%s>", ctx->wm_path.c_str());
+		}
+		srvInterface.log("DBLINK watermark %s advanced to <%s>", ctx->wm_col.c_str(), value.c_str()) ;
+	}
+
+	// Chunked extraction (chunk_column): run the query as chunks of chunk_rows rows ordered on
+	// the chunk column, each one above the last key returned, then the rows with a NULL key. The
+	// key must be unique: rows sharing the last key of a chunk would be skipped. A chunk failing
+	// to execute or fetch is retried on a new connection, after a growing delay, from the last
+	// key returned: no row is returned twice. Running out of retries fails the call.
+	void fetchChunks(ServerInterface &srvInterface, PartitionWriter &outputWriter)
+	{
+		SQLRETURN Oret = 0 ;
+		std::string first = ctx->chunk_query(dbt, true), next = ctx->chunk_query(dbt, false) ;
+		std::string last = ctx->null_chunk_query() ;
+		std::string key ;		// last key returned
+		const ColPlan &cp = ctx->Oplan[Iwm] ;
+		size_t chunks = 0, retries = 0 ;
+		bool nulls = false ;	// past the last chunk: rows with a NULL key
+
+		for ( ; ; ) {
+			size_t rows = St.rows ;
+			std::string err ;
+
+			// Execute and fetch the chunk; failures are retried below
+			Iwmlen = SQL_NTS ;
+			if ( nulls ) {
+				(void)SQLFreeStmt(Ist, SQL_RESET_PARAMS) ;
+			} else if ( !key.empty() && !SQL_SUCCEEDED(Oret=SQLBindParameter(Ist, 1, SQL_PARAM_INPUT, SQL_C_CHAR, cp.sqlt, cp.size,
+					cp.decimals, (SQLPOINTER)key.c_str(), 0, &Iwmlen)) ) {
+				ex_err(SQL_HANDLE_STMT, Ist, 434, "Error binding the chunk key parameter");
+			}
+			if ( !SQL_SUCCEEDED(Oret=timedExecute(nulls ? last.c_str() : key.empty() ? first.c_str() : next.c_str())) && Oret != SQL_NO_DATA ) {
+				err = odbc_diag(SQL_HANDLE_STMT, Ist) ;
+			} else {
+				while ( SQL_SUCCEEDED(Oret=timedFetch()) && !canceled() )
+					convertRowset(outputWriter, 0, nfr) ;
+				if ( Oret != SQL_NO_DATA && !SQL_SUCCEEDED(Oret) )
+					err = odbc_diag(SQL_HANDLE_STMT, Ist) ;
+			}
+			(void)SQLFreeStmt(Ist, SQL_CLOSE) ;
+			if ( Iwmset )
+				key = watermarkText() ;
+			if ( canceled() )
+				return ;
+			if ( err.empty() ) {
+				chunks++ ;
+				retries = 0 ;
+				if ( nulls )
+					break ;
+				nulls = St.rows - rows < ctx->chunk_rows ;		// short chunk: the last one
+				continue ;
+			}
+
+			// Failed chunk: retry on a new connection, or give up
+			if ( retries++ == Iretries ) {
+				vt_report_error(435, "DBLINK. Chunk %zu failed after %zu retries. %s", chunks + 1, Iretries, err.c_str());
+			}
+			long ms = std::min((long)CHUNK_BACKOFF_MAX_MS, (long)CHUNK_BACKOFF_MS << std::min(retries - 1, (size_t)16)) ;
+			srvInterface.log("DBLINK chunk %zu failed, retry %zu of %zu in %ld ms. %s", chunks + 1, retries, Iretries, ms, err.c_str()) ;
+			std::this_thread::sleep_for(std::chrono::milliseconds(ms)) ;
+			if ( canceled() )
+				return ;
+			(void)SQLFreeHandle(SQL_HANDLE_STMT, Ist) ;
+			Ist = 0 ;
+			registry.release(ctx->connstr, Icon, false) ;
+			Icon = 0 ;
+			double waited = 0 ;
+			Icon = registry.connect(ctx->connstr, ctx->admission(0), 204, &waited) ;
+			St.wait(waited) ;
+			if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, Icon, &Ist))){
+				ex_err(SQL_HANDLE_DBC, Icon, 208, "Error allocating Statement Handle");
+			}
+			if ( ctx->profile )
+				stream_stmt(Ist) ;
+			if ( Itimeout )
+				(void)SQLSetStmtAttr(Ist, SQL_ATTR_QUERY_TIMEOUT, (SQLPOINTER)Itimeout, 0) ;
+			bindColumns(Ist, NULL, &nfr) ;
+			Iprepared = false ;
+		}
+		srvInterface.log("DBLINK chunked extraction on %s done: %zu chunks", ctx->wm_col.c_str(), chunks) ;
+	}
+
+	// Log the partition stats (and append them to the stats file), then start over:
+	void reportStats(ServerInterface &srvInterface)
+	{
+		std::string line = St.line() ;
+
+		srvInterface.log("DBLINK stats: %s", line.c_str()) ;
+		if ( !Istatsfile.empty() ) {
+			char ts[32] ;
+			time_t now = time(NULL) ;
+			struct tm tm ;
+			strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", localtime_r(&now, &tm)) ;
+			std::string q = ctx->query ;
+			std::replace(q.begin(), q.end(), '\n', ' ') ;
+			std::replace(q.begin(), q.end(), '\t', ' ') ;
+			line = std::string(ts) + '\t' + srvInterface.getCurrentNodeName() + '\t' + line + '\t' + q + '\n' ;
+			FILE *f = fopen(Istatsfile.c_str(), "a") ;	// one write per line: lines of concurrent instances do not mix
+			if ( !f || fputs(line.c_str(), f) == EOF ) {
+				srvInterface.log("DBLINK cannot append stats to <%s>", Istatsfile.c_str()) ;
+			}
+			if ( f )
+				fclose(f) ;
+		}
+		St = Stats() ;
+	}
+
+	// Fetch and convert the result set. The writer is the PartitionWriter, or a CacheWriter
+	// recording the values for the local cache:
+	template <class W>
+	void fetchRows(W &outputWriter)
+	{
+		SQLRETURN Oret = 0 ;
+
+		if ( nbuf > 1 ) {
+			fetchPipeline(outputWriter) ;
+			return ;
+		}
+
+		// Fetch loop:
+		while ( SQL_SUCCEEDED(Oret=timedFetch()) && !canceled() ) {
+			convertRowset(outputWriter, 0, nfr) ;
+		}
+		if ( Oret != SQL_NO_DATA && !SQL_SUCCEEDED(Oret) && !canceled() ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 412, "Error fetching rows");
+		}
+	}
+
+	// Fetch the next rowset (timed). With an adaptive rowset the array size grows while full rowsets
+	// come back quickly and shrinks when a round trip gets slow. Buffers are always allocated
+	// for "rowset" rows, the maximum array size.
+	SQLRETURN timedFetch()
+	{
+		SQLRETURN Oret = 0 ;
+		size_t next = Iarray ;
+
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+		Oret = SQLFetchScroll(Ist, SQL_FETCH_NEXT, 0) ;
+		double secs = secs_since(t0) ;
+		St.fetch += secs ;
+		if ( !St.fetches++ )
+			St.first_row = secs_since(Texec) ;
+		if ( Iadapt && SQL_SUCCEEDED(Oret) ) {
+			if ( nfr == Iarray && secs < ADAPT_FAST_SECS && Iarray < rowset )
+				next = std::min(rowset, Iarray * 2) ;
+			else if ( secs > ADAPT_SLOW_SECS && Iarray > ADAPT_MIN_ROWSET )
+				next = std::max((size_t)ADAPT_MIN_ROWSET, Iarray / 2) ;
+			if ( next != Iarray && SQL_SUCCEEDED(SQLSetStmtAttr(Ist, SQL_ATTR_ROW_ARRAY_SIZE, (SQLPOINTER)next, 0)) )
+				Iarray = next ;
+		}
+		return Oret ;
+	}
+
+	// Pipelined fetch. A background thread fetches rowsets into the "nbuf" arena buffers while
+	// the UDx thread converts them. The producer only calls ODBC; the handoff is lock-free:
+	// Phead (rowsets fetched) is only written by the producer, Ptail (rowsets converted) by the
+	// consumer. Buffer "n % nbuf" is owned by the producer while n - Ptail < nbuf.
+	void fetchProducer()
+	{
+		SQLRETURN Oret = 0 ;
+		unsigned int spins = 0 ;
+
+		for ( size_t n = 0 ; !Pstop.load(std::memory_order_acquire) ; ) {
+			if ( n - Ptail.load(std::memory_order_acquire) == nbuf ) {
+				pipelineWait(spins) ;
+				continue ;
+			}
+			spins = 0 ;
+			Ooff = (SQLULEN)((n % nbuf) * Oarena) ;
+			if ( !SQL_SUCCEEDED(Oret=timedFetch()) )
+				break ;
+			Pnfr[n % nbuf] = nfr ;
+			Phead.store(++n, std::memory_order_release) ;
+		}
+		Pret = Oret ;
+		Pdone.store(true, std::memory_order_release) ;
+	}
+
+	static void pipelineWait(unsigned int &spins)
+	{
+		if ( ++spins < 64 )
+			std::this_thread::yield() ;
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(100)) ;
+	}
+
+	template <class W>
+	void fetchPipeline(W &outputWriter)
+	{
+		unsigned int spins = 0 ;
+
+		Phead.store(0) ;
+		Ptail.store(0) ;
+		Pstop.store(false) ;
+		Pdone.store(false) ;
+		Pret = SQL_SUCCESS ;
+		{
+			std::thread producer(&DBLink::fetchProducer, this) ;
+			struct Joiner {				// stop and join the producer even if conversion throws
+				DBLink *d ; std::thread &t ;
+				~Joiner() { d->Pstop.store(true, std::memory_order_release) ; t.join() ; }
+			} joiner = { this, producer } ;
+
+			for ( size_t t = 0 ; ; ) {
+				if ( t == Phead.load(std::memory_order_acquire) ) {
+					if ( Pdone.load(std::memory_order_acquire) && t == Phead.load(std::memory_order_acquire) )
+						break ;
+					if ( canceled() )
+						break ;
+					pipelineWait(spins) ;
+					continue ;
+				}
+				spins = 0 ;
+				convertRowset(outputWriter, (t % nbuf) * Oarena, Pnfr[t % nbuf]) ;
+				Ptail.store(++t, std::memory_order_release) ;
+			}
+		}
+		if ( Pret != SQL_NO_DATA && !SQL_SUCCEEDED(Pret) && !canceled() ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 412, "Error fetching rows");
+		}
+	}
+
+	// Shards: run the query on the shards of the partition at once, one thread and connection
+	// per shard fetching into its own arena buffer, while the UDx thread converts the rowsets
+	// as they come (rows of different shards are interleaved): the partition lasts as long as
+	// its slowest shard. Shard numbers come from the first (INTEGER) input column, so shards
+	// can be spread across nodes; without input columns all shards are fetched here.
+	void shardPartition(ServerInterface &srvInterface, PartitionReader &inputReader, PartitionWriter &outputWriter)
+	{
+		std::vector<size_t> list ;
+
+		if ( inputReader.getNumCols() == 0 ) {
+			for ( size_t n = 0 ; n < ctx->shards.size() ; n++ )
+				list.push_back(n) ;
+		} else {
+			if ( !inputReader.getTypeMetaData().getColumnType(0).isInt() ) {
+				ex_err(0, 0, 427, "Shards expect shard numbers (INTEGER) as first input column");
+			}
+			do {
+				if ( inputReader.isNull(0) )
+					continue ;
+				vint n = inputReader.getIntRef(0) ;
+				if ( n < 0 || (size_t)n >= ctx->shards.size() ) {
+					vt_report_error(428, "DBLINK. Shard %lld out of range [0, %zu]", (long long)n, ctx->shards.size() - 1);
+				}
+				if ( std::find(list.begin(), list.end(), (size_t)n) == list.end() )
+					list.push_back((size_t)n) ;
+			} while ( inputReader.next() && !canceled() ) ;
+		}
+		if ( list.empty() )
+			return ;
+
+		// The shard threads only fetch: long columns are bound (no SQLGetData), no pipeline
+		Ilobs = false ;
+		Iadapt = false ;
+		nbuf = 1 ;
+		buildPlan(srvInterface) ;
+		allocBuffers(srvInterface, list.size()) ;
+
+		std::vector<Shard> sh(list.size()) ;
+		std::vector<std::thread> threads ;
+		for ( size_t k = 0 ; k < sh.size() ; k++ ) {
+			sh[k].n = list[k] ;
+			sh[k].off = (SQLULEN)( k * Oarena ) ;
+		}
+		Sstop.store(false) ;
+		{
+			struct Joiner {				// stop, cancel and join the shard threads even if conversion throws
+				DBLink *d ; std::vector<Shard> &sh ; std::vector<std::thread> &t ;
+				~Joiner() {
+					d->Sstop.store(true, std::memory_order_release) ;
+					for ( size_t k = 0 ; k < sh.size() ; k++ )
+						if ( sh[k].state.load(std::memory_order_acquire) != SHARD_DONE && sh[k].st.load() )
+							(void)SQLCancel(sh[k].st.load()) ;
+					for ( size_t k = 0 ; k < t.size() ; k++ )
+						t[k].join() ;
+					for ( size_t k = 0 ; k < sh.size() ; k++ )
+						d->releaseShard(sh[k]) ;
+					d->Ishard = NULL ;
+				}
+			} joiner = { this, sh, threads } ;
+
+			for ( size_t k = 0 ; k < sh.size() ; k++ )
+				threads.emplace_back(&DBLink::shardFetch, this, std::ref(sh[k])) ;
+
+			std::vector<bool> done(sh.size(), false) ;
+			unsigned int spins = 0 ;
+			for ( size_t live = sh.size() ; live && !canceled() ; ) {
+				bool any = false ;
+				for ( size_t k = 0 ; k < sh.size() ; k++ ) {
+					int state = sh[k].state.load(std::memory_order_acquire) ;
+					if ( state == SHARD_READY ) {
+						Ishard = ctx->shard_col ? &ctx->shards[sh[k].n] : NULL ;
+						convertRowset(outputWriter, sh[k].off, sh[k].nfr) ;
+						sh[k].state.store(SHARD_FETCHING, std::memory_order_release) ;
+						any = true ;
+					} else if ( state == SHARD_DONE && !done[k] ) {
+						done[k] = true ;
+						live-- ;
+						if ( !sh[k].err.empty() ) {
+							vt_report_error(429, "DBLINK. Shard <%s>: %s", ctx->shards[sh[k].n].c_str(), sh[k].err.c_str());
+						}
+					}
+				}
+				if ( any )
+					spins = 0 ;
+				else
+					pipelineWait(spins) ;
+			}
+			for ( size_t k = 0 ; k < sh.size() ; k++ ) {
+				St.execute = std::max(St.execute, sh[k].execute) ;
+				St.fetch += sh[k].fetch ;
+				St.fetches += sh[k].fetches ;
+				St.wait(sh[k].admit) ;
+				if ( sh[k].fetches && ( !St.first_row || sh[k].first_row < St.first_row ) )
+					St.first_row = sh[k].first_row ;
+			}
+		}
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK %zu shards fetched, rowset=%zu", sh.size(), rowset);
+#endif
+	}
+
+	// Shard thread: connect (shard 0 uses the instance connection), execute, check the result
+	// set against the described one and fetch rowsets into the shard buffer, one at a time.
+	// Only ODBC is called here: errors are passed to the UDx thread.
+	void shardFetch(Shard &s)
+	{
+		SQLRETURN Oret = 0 ;
+		SQLHSTMT Oh = 0 ;
+		unsigned int spins = 0 ;
+
+		try {
+			if ( s.n == 0 ) {
+				Oh = Ist ;
+			} else {
+				s.con = registry.connect(ctx->shard_cs[s.n], ctx->admission(s.n), 204, &s.admit) ;
+				if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, s.con, &Oh))){
+					ex_err(SQL_HANDLE_DBC, s.con, 208, "Error allocating Statement Handle");
+				}
+				if ( ctx->profile )
+					stream_stmt(Oh) ;
+				if ( Itimeout )
+					(void)SQLSetStmtAttr(Oh, SQL_ATTR_QUERY_TIMEOUT, (SQLPOINTER)Itimeout, 0) ;
+			}
+			s.st.store(Oh) ;
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+			if ( !Sstop.load(std::memory_order_acquire) ) {
+				Oret = s.n == 0 && Iprepared ? SQLExecute(Oh) : SQLExecDirect(Oh, (SQLCHAR *)ctx->query.c_str(), SQL_NTS) ;
+				s.execute = secs_since(t0) ;
+				if ( !SQL_SUCCEEDED(Oret) && Oret != SQL_NO_DATA ) {
+					ex_err(SQL_HANDLE_STMT, Oh, 430, "Error executing the statement");
+				}
+				checkShard(Oh) ;
+				bindColumns(Oh, &s.off, &s.nfr) ;
+			}
+			while ( !Sstop.load(std::memory_order_acquire) ) {
+				std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now() ;
+				Oret = SQLFetchScroll(Oh, SQL_FETCH_NEXT, 0) ;
+				s.fetch += secs_since(t1) ;
+				if ( !s.fetches++ )
+					s.first_row = secs_since(t0) ;
+				if ( Oret == SQL_NO_DATA )
+					break ;
+				if ( !SQL_SUCCEEDED(Oret) ) {
+					ex_err(SQL_HANDLE_STMT, Oh, 412, "Error fetching rows");
+				}
+				s.state.store(SHARD_READY, std::memory_order_release) ;
+				for ( spins = 0 ; s.state.load(std::memory_order_acquire) == SHARD_READY && !Sstop.load(std::memory_order_acquire) ; )
+					pipelineWait(spins) ;
+			}
+		} catch ( std::exception &e ) {
+			s.err = e.what() ;
+		}
+		s.state.store(SHARD_DONE, std::memory_order_release) ;
+	}
+
+	// Shards must return the columns described on the first one: same number and types, same
+	// NUMERIC precision and scale (string lengths may differ, longer values are truncated).
+	void checkShard(SQLHSTMT Oh)
+	{
+		SQLSMALLINT Oncols = 0, Otype = 0, Odec = 0, Onull = 0, Onamel = 0 ;
+		SQLULEN Osize = 0 ;
+		SQLCHAR Ocname[MAXCNAMELEN] ;
+		char Omsg[96] ;
+
+		if ( !SQL_SUCCEEDED(SQLNumResultCols(Oh, &Oncols)) || Oncols != (SQLSMALLINT)Oncol ) {
+			ex_err(0, 0, 431, "Shard result set columns do not match the first shard");
+		}
+		for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
+			const ColPlan &cp = ctx->Oplan[j] ;
+			if ( !SQL_SUCCEEDED(SQLDescribeCol(Oh, (SQLUSMALLINT)(j+1), Ocname, (SQLSMALLINT)MAXCNAMELEN, &Onamel,
+					&Otype, &Osize, &Odec, &Onull)) || Otype != cp.sqlt ||
+					( ( Otype == SQL_NUMERIC || Otype == SQL_DECIMAL ) && ( Osize != cp.size || Odec != cp.decimals ) ) ) {
+				snprintf(Omsg, sizeof(Omsg), "Shard result set column %u does not match the first shard", j + 1) ;
+				ex_err(0, 0, 431, Omsg);
+			}
+		}
+	}
+
+	// Give back the connection of a shard (the instance one is kept, its cursor closed):
+	void releaseShard(Shard &s)
+	{
+		SQLHSTMT Oh = s.st.load() ;
+
+		if ( !s.con ) {
+			if ( Oh )
+				(void)SQLFreeStmt(Oh, SQL_CLOSE) ;
+			return ;
+		}
+		if ( Oh )
+			(void)SQLFreeHandle(SQL_HANDLE_STMT, Oh);
+		registry.release(ctx->shard_cs[s.n], s.con, ctx->pooling && !canceled() && s.err.empty()) ;
+		s.con = 0 ;
+	}
+
+	// Slice bound in input column "c" as a SQL literal: INTEGER values, or VARCHAR literals (for
+	// example '2024-01-01'). NULL is an open bound.
+	std::string sliceBound(PartitionReader &inputReader, size_t c)
+	{
+		const VerticaType &vt = inputReader.getTypeMetaData().getColumnType(c) ;
+
+		if ( inputReader.isNull(c) )
+			return "" ;
+		if ( vt.isInt() )
+			return std::to_string((long long)inputReader.getIntRef(c)) ;
+		if ( !vt.isStringType() ) {
+			ex_err(0, 0, 438, "Slice bounds in input must be INTEGER or VARCHAR (SQL literals)");
+		}
+		return inputReader.getStringRef(c).str() ;
+	}
+
+	// Extract a split slice ("squery", from split_query or range_query)
+	void fetchSlice(ServerInterface &srvInterface, const std::string &squery, PartitionWriter &outputWriter)
+	{
+		SQLRETURN Oret = 0 ;
+
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK slice query=<%s>", squery.c_str() );
+#endif
+		if (!SQL_SUCCEEDED(Oret=timedExecute(squery.c_str())) && Oret != SQL_NO_DATA ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 411, "Error executing split statement");
+		}
+		fetchRows(outputWriter) ;
+		(void)SQLFreeStmt(Ist, SQL_CLOSE) ;
+	}
+
+	// COPY source (DBLinkSource): execute the query, or split slice "s" (-1: the whole query),
+	// and bind one rowset buffer. Rows are then fetched one rowset at a time with fetchRowset().
+	void sourceExecute(ServerInterface &srvInterface, long s)
+	{
+		SQLRETURN Oret = 0 ;
+		std::string squery = s < 0 ? ctx->query : ctx->split_query((size_t)s) ;
+		const char *query = s < 0 && Iprepared ? NULL : squery.c_str() ;
+
+		nbuf = 1 ;
+		buildPlan(srvInterface) ;
+		allocBuffers(srvInterface, nbuf) ;
+		bindColumns(Ist, NULL, &nfr) ;
+		if ( !SQL_SUCCEEDED(Oret=timedExecute(query)) && Oret != SQL_NO_DATA ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 433, "Error executing the source statement");
+		}
+	}
+
+	// COPY source: fetch and convert the next rowset. Returns false at the end of the result set.
+	template <class W>
+	bool fetchRowset(W &outputWriter)
+	{
+		SQLRETURN Oret = timedFetch() ;
+
+		if ( SQL_SUCCEEDED(Oret) ) {
+			convertRowset(outputWriter, 0, nfr) ;
+			return true ;
+		}
+		if ( Oret != SQL_NO_DATA ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 412, "Error fetching rows");
+		}
+		return false ;
+	}
+
+	// Parameter plans from the input column types (sink and lookup modes) and parameter arrays
+	// of batch_size rows (limited to SINK_BUFFER_MB):
+	void paramPlan(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+	{
+		ParamReader params = srvInterface.getParamReader();
+		size_t rowbytes = 0 ;
+
+		Incol = (unsigned int)argTypes.getColumnCount() ;
+		Ibatch = DEF_BATCH ;
+		if( params.containsParameter("batch_size") ) {
+			vint batch_param = params.getIntRef("batch_size") ;
+			if ( batch_param < 1 || batch_param > MAX_BATCH ) {
+				vt_report_error(215, "DBLINK. batch_size out of range [1, %d]", MAX_BATCH);
+			}
+			Ibatch = (size_t) batch_param ;
+		}
+		if ( ctx->mode == MODE_LOOKUP && Ibatch > lookup_max(dbt) ) {
+			srvInterface.log("DBLINK lookup batch_size %zu reduced to %zu, the remote DBMS limit", Ibatch, lookup_max(dbt)) ;
+			Ibatch = lookup_max(dbt) ;
+		}
+		Ipar = (ColPlan *)srvInterface.allocator->alloc(Incol * sizeof(ColPlan)) ;
+		Pbuf = (SQLPOINTER *)srvInterface.allocator->alloc(Incol * sizeof(SQLPOINTER)) ;
+		Plen = (SQLLEN **)srvInterface.allocator->alloc(Incol * sizeof(SQLLEN *)) ;
+		for ( unsigned int c = 0 ; c < Incol ; c++ ) {
+			const VerticaType &vt = argTypes.getColumnType(c) ;
+			ColPlan &pp = Ipar[c] ;
+			pp.size = 0 ;
+			pp.decimals = 0 ;
+			if ( vt.isInt() ) {
+				pp.sqlt = SQL_BIGINT ;
+				pp.set(sizeof(SQLBIGINT), SQL_C_SBIGINT, CK_INT) ;
+			} else if ( vt.isFloat() ) {
+				pp.sqlt = SQL_DOUBLE ;
+				pp.set(sizeof(SQLDOUBLE), SQL_C_DOUBLE, CK_FLOAT) ;
+			} else if ( vt.isBool() ) {
+				pp.sqlt = SQL_BIT ;
+				pp.set(1, SQL_C_BIT, CK_BOOL) ;
+			} else if ( vt.isNumeric() ) {
+				pp.sqlt = SQL_NUMERIC ;
+				pp.size = (SQLULEN)vt.getNumericPrecision() ;
+				pp.decimals = (SQLSMALLINT)vt.getNumericScale() ;
+				pp.set(MAX_NUMERIC_CHARLEN, SQL_C_CHAR, CK_NUMERIC) ;
+			} else if ( vt.isChar() || vt.isVarchar() || vt.isLongVarchar() ) {
+				pp.sqlt = vt.isChar() ? SQL_CHAR : vt.isVarchar() ? SQL_VARCHAR : SQL_LONGVARCHAR ;
+				pp.size = (SQLULEN)vt.getStringLength() ;
+				pp.set(std::max((size_t)pp.size, (size_t)1), SQL_C_CHAR, CK_STRING) ;
+			} else if ( vt.isBinary() || vt.isVarbinary() || vt.isLongVarbinary() ) {
+				pp.sqlt = vt.isBinary() ? SQL_BINARY : vt.isVarbinary() ? SQL_VARBINARY : SQL_LONGVARBINARY ;
+				pp.size = (SQLULEN)vt.getStringLength() ;
+				pp.set(std::max((size_t)pp.size, (size_t)1), SQL_C_BINARY, CK_STRING) ;
+			} else if ( vt.isDate() ) {
+				pp.sqlt = SQL_TYPE_DATE ;
+				pp.size = 10 ;
+				pp.set(sizeof(SQL_DATE_STRUCT), SQL_C_DATE, CK_DATE) ;
+			} else if ( vt.isTimestamp() || vt.isTimestampTz() ) {
+				pp.sqlt = SQL_TYPE_TIMESTAMP ;
+				pp.size = 26 ;
+				pp.decimals = 6 ;
+				pp.set(sizeof(SQL_TIMESTAMP_STRUCT), SQL_C_TIMESTAMP, vt.isTimestamp() ? CK_TIMESTAMP : CK_TIMESTAMPTZ) ;
+			} else if ( vt.isTime() ) {
+				pp.sqlt = SQL_TYPE_TIME ;
+				pp.size = 8 ;
+				pp.set(sizeof(SQL_TIME_STRUCT), SQL_C_TIME, CK_TIME) ;
+			} else if ( vt.isIntervalYM() ) {
+				pp.sqlt = SQL_INTERVAL_YEAR_TO_MONTH ;
+				pp.set(sizeof(SQL_INTERVAL_STRUCT), SQL_C_INTERVAL_YEAR_TO_MONTH, CK_INTERVAL_YM) ;
+			} else if ( vt.isInterval() ) {
+				pp.sqlt = SQL_INTERVAL_DAY_TO_SECOND ;
+				pp.decimals = 6 ;
+				pp.set(sizeof(SQL_INTERVAL_STRUCT), SQL_C_INTERVAL_DAY_TO_SECOND, CK_INTERVAL_DS) ;
+			} else {
+				vt_report_error(217, "DBLINK. Unsupported data type %s for input column %u", vt.getTypeStr().c_str(), c);
+			}
+			rowbytes += pp.desz + sizeof(SQLLEN) ;
+		}
+		Ibatch = std::max((size_t)1, std::min(Ibatch, ( (size_t)SINK_BUFFER_MB << 20 ) / rowbytes)) ;
+		for ( unsigned int c = 0 ; c < Incol ; c++ ) {
+			Plen[c] = (SQLLEN *)srvInterface.allocator->alloc(sizeof(SQLLEN) * Ibatch) ;
+			Pbuf[c] = (SQLPOINTER)srvInterface.allocator->alloc(Ipar[c].desz * Ibatch) ;
+		}
+
+	}
+
+	// Sink mode setup: parameter arrays bound once, column-wise. Autocommit is off.
+	void sinkSetup(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+	{
+		SQLRETURN Oret = 0 ;
+		ParamReader params = srvInterface.getParamReader();
+
+		if ( (SQLSMALLINT)argTypes.getColumnCount() != ctx->npar ) {
+			vt_report_error(214, "DBLINK. Sink query has %d parameters, %u input columns", (int)ctx->npar, (unsigned int)argTypes.getColumnCount());
+		}
+		Icommit = 0 ;
+		if( params.containsParameter("commit_batches") ) {
+			vint commit_param = params.getIntRef("commit_batches") ;
+			if ( commit_param < 0 ) {
+				vt_report_error(216, "DBLINK. commit_batches must be >= 0");
+			}
+			Icommit = (size_t) commit_param ;
+		}
+
+		paramPlan(srvInterface, argTypes) ;
+		Pstat = (SQLUSMALLINT *)srvInterface.allocator->alloc(sizeof(SQLUSMALLINT) * Ibatch) ;
+
+		// Column-wise parameter arrays:
+		for ( unsigned int c = 0 ; c < Incol ; c++ ) {
+			if (!SQL_SUCCEEDED(Oret=SQLBindParameter(Ist, (SQLUSMALLINT)(c + 1), SQL_PARAM_INPUT, Ipar[c].ctype,
+					Ipar[c].sqlt, Ipar[c].size, Ipar[c].decimals, Pbuf[c], (SQLLEN)Ipar[c].desz, Plen[c]))) {
+				ex_err(SQL_HANDLE_STMT, Ist, 218, "Error binding parameter");
+			}
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ist, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0)) ||
+			!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ist, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)Ibatch, 0)) ||
+			!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ist, SQL_ATTR_PARAMS_PROCESSED_PTR, &Pproc, 0)) ||
+			!SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ist, SQL_ATTR_PARAM_STATUS_PTR, Pstat, 0))) {
+			ex_err(SQL_HANDLE_STMT, Ist, 219, "Error setting parameter array attributes");
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLSetConnectAttr(Icon, SQL_ATTR_AUTOCOMMIT, (SQLPOINTER)SQL_AUTOCOMMIT_OFF, 0))) {
+			ex_err(SQL_HANDLE_DBC, Icon, 220, "Error setting autocommit off");
+		}
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK sink %u parameters, batch=%zu rows, commit every %zu batches", Incol, Ibatch, Icommit);
+#endif
+	}
+
+	// Lookup mode setup: the query single marker becomes an IN list of batch_size markers (at
+	// most lookup_max of the remote DBMS), each bound to an element of the key array.
+	void lookupSetup(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+	{
+		SQLRETURN Oret = 0 ;
+		std::string lquery ;
+
+		if ( argTypes.getColumnCount() != 1 ) {
+			vt_report_error(221, "DBLINK. Lookup mode expects one input column (the key)");
+		}
+		paramPlan(srvInterface, argTypes) ;
+		if ( !expand_marker(ctx->query, Ibatch, lquery) ) {
+			vt_report_error(222, "DBLINK. Lookup query must have exactly one parameter marker");
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLPrepare(Ist, (SQLCHAR *)lquery.c_str(), SQL_NTS))) {
+			ex_err(SQL_HANDLE_STMT, Ist, 223, "Error preparing the lookup statement");
+		}
+		for ( size_t k = 0 ; k < Ibatch ; k++ ) {
+			if (!SQL_SUCCEEDED(Oret=SQLBindParameter(Ist, (SQLUSMALLINT)(k + 1), SQL_PARAM_INPUT, Ipar[0].ctype,
+					Ipar[0].sqlt, Ipar[0].size, Ipar[0].decimals, (uint8_t *)Pbuf[0] + Ipar[0].desz * k,
+					(SQLLEN)Ipar[0].desz, &Plen[0][k]))) {
+				ex_err(SQL_HANDLE_STMT, Ist, 218, "Error binding parameter");
+			}
+		}
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK lookup batch=%zu keys", Ibatch);
+#endif
+	}
+
+	// Lookup mode: distinct non NULL keys of the partition are sent "Ibatch" at a time
+	void lookupPartition(PartitionReader &inputReader, PartitionWriter &outputWriter)
+	{
+		size_t n = 0 ;
+
+		Iseen.clear() ;
+		do {
+			if ( inputReader.isNull(0) )
+				continue ;		// NULL keys never match
+			paramRow(inputReader, n) ;
+			const char *k = (const char *)Pbuf[0] + Ipar[0].desz * n ;
+			SQLLEN kl = Plen[0][n] ;
+			if ( !Iseen.insert(std::string(k, kl == SQL_NTS ? strlen(k) : (size_t)kl)).second )
+				continue ;
+			if ( ++n == Ibatch ) {
+				lookupBatch(n, outputWriter) ;
+				n = 0 ;
+			}
+		} while ( inputReader.next() && !canceled() ) ;
+		if ( n && !canceled() )
+			lookupBatch(n, outputWriter) ;
+	}
+
+	// Run the lookup query for the first "n" keys (the IN list is padded with the first one)
+	void lookupBatch(size_t n, PartitionWriter &outputWriter)
+	{
+		SQLRETURN Oret = 0 ;
+
+		for ( size_t k = n ; k < Ibatch ; k++ ) {
+			memcpy((uint8_t *)Pbuf[0] + Ipar[0].desz * k, Pbuf[0], Ipar[0].desz) ;
+			Plen[0][k] = Plen[0][0] ;
+		}
+		if (!SQL_SUCCEEDED(Oret=timedExecute(NULL)) && Oret != SQL_NO_DATA ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 418, "Error executing the lookup statement");
+		}
+		fetchRows(outputWriter) ;
+		(void)SQLFreeStmt(Ist, SQL_CLOSE) ;
+	}
+
+	// Copy input row "r" into the parameter arrays:
+	void paramRow(PartitionReader &inputReader, size_t r)
+	{
+		for ( unsigned int c = 0 ; c < Incol ; c++ ) {
+			uint8_t *Opp = (uint8_t *)Pbuf[c] + Ipar[c].desz * r ;
+			SQLLEN &Opl = Plen[c][r] ;
+
+			if ( inputReader.isNull(c) ) {
+				Opl = SQL_NULL_DATA ;
+				continue ;
+			}
+			Opl = (SQLLEN)Ipar[c].desz ;
+			switch ( Ipar[c].kind ) {
+				case CK_INT:
+					*(SQLBIGINT *)Opp = inputReader.getIntRef(c) ;
+					break ;
+				case CK_FLOAT:
+					*(SQLDOUBLE *)Opp = inputReader.getFloatRef(c) ;
+					break ;
+				case CK_BOOL:
+					*(SQLCHAR *)Opp = inputReader.getBoolRef(c) == VTrue ? SQL_TRUE : SQL_FALSE ;
+					break ;
+				case CK_NUMERIC:
+					inputReader.getNumericRef(c).toString((char *)Opp, (int)Ipar[c].desz) ;
+					Opl = SQL_NTS ;
+					break ;
+				case CK_STRING:
+					{
+						const VString &vs = inputReader.getStringRef(c) ;
+						Opl = (SQLLEN)std::min((size_t)vs.length(), Ipar[c].desz) ;
+						memcpy(Opp, vs.data(), (size_t)Opl) ;
+						break ;
+					}
+				case CK_DATE:
+					odbc_date(inputReader.getDateRef(c), *(SQL_DATE_STRUCT *)Opp) ;
+					break ;
+				case CK_TIMESTAMP:
+					odbc_timestamp(inputReader.getTimestampRef(c), *(SQL_TIMESTAMP_STRUCT *)Opp) ;
+					break ;
+				case CK_TIMESTAMPTZ:	// back to the remote UTC offset (timestamptz param)
+					odbc_timestamp((Timestamp)(inputReader.getTimestampTzRef(c) + Itzoff), *(SQL_TIMESTAMP_STRUCT *)Opp) ;
+					break ;
+				case CK_TIME:
+					{
+						SQL_TIME_STRUCT &st = *(SQL_TIME_STRUCT *)Opp ;
+						TimeADT t = inputReader.getTimeRef(c) ;
+						st.hour = (SQLUSMALLINT)( t / usPerHour ) ;
+						st.minute = (SQLUSMALLINT)( t / usPerMinute % 60 ) ;
+						st.second = (SQLUSMALLINT)( t / usPerSecond % 60 ) ;
+						break ;
+					}
+				case CK_INTERVAL_YM:
+					{
+						SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT *)Opp ;
+						IntervalYM m = inputReader.getIntervalYMRef(c) ;
+						memset(&intv, 0, sizeof(intv)) ;
+						intv.interval_type = SQL_IS_YEAR_TO_MONTH ;
+						intv.interval_sign = m < 0 ? SQL_TRUE : SQL_FALSE ;
+						m = m < 0 ? -m : m ;
+						intv.intval.year_month.year = (SQLUINTEGER)( m / MONTHS_PER_YEAR ) ;
+						intv.intval.year_month.month = (SQLUINTEGER)( m % MONTHS_PER_YEAR ) ;
+						break ;
+					}
+				case CK_INTERVAL_DS:
+					{
+						SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT *)Opp ;
+						Interval us = inputReader.getIntervalRef(c) ;
+						memset(&intv, 0, sizeof(intv)) ;
+						intv.interval_type = SQL_IS_DAY_TO_SECOND ;
+						intv.interval_sign = us < 0 ? SQL_TRUE : SQL_FALSE ;
+						us = us < 0 ? -us : us ;
+						intv.intval.day_second.day = (SQLUINTEGER)( us / usPerDay ) ;
+						intv.intval.day_second.hour = (SQLUINTEGER)( us / usPerHour % 24 ) ;
+						intv.intval.day_second.minute = (SQLUINTEGER)( us / usPerMinute % 60 ) ;
+						intv.intval.day_second.second = (SQLUINTEGER)( us / usPerSecond % 60 ) ;
+						intv.intval.day_second.fraction = (SQLUINTEGER)( us % usPerSecond * 1000 ) ;
+						break ;
+					}
+				default:
+					break ;
+			}
+		}
+	}
+
+	// Send the first "n" rows of the parameter arrays. Returns the number of rows written: drivers
+	// going on after a failed row count it as processed, so rows are counted on their status and
+	// any failed row fails the batch.
+	SQLULEN sinkBatch(size_t n, size_t b)
+	{
+		SQLRETURN Oret = 0 ;
+
+		if ( n != Ibatch && !SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ist, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)n, 0)) ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 415, "Error setting statement attribute SQL_ATTR_PARAMSET_SIZE");
+		}
+		Pproc = 0 ;
+		std::fill(Pstat, Pstat + n, (SQLUSMALLINT)SQL_PARAM_UNUSED) ;
+		if (!SQL_SUCCEEDED(Oret=timedExecute(NULL)) && Oret != SQL_NO_DATA ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 416, "Error executing the sink statement");
+		}
+		SQLULEN Ook = 0, Obad = 0, Ofirst = 0 ;
+		for ( size_t k = 0 ; k < n ; k++ ) {
+			switch ( Pstat[k] ) {
+				case SQL_PARAM_SUCCESS:
+				case SQL_PARAM_SUCCESS_WITH_INFO:
+				case SQL_PARAM_DIAG_UNAVAILABLE:	// array executed as a whole, which succeeded
+					Ook++ ;
+					break ;
+				case SQL_PARAM_ERROR:
+					if ( !Obad++ )
+						Ofirst = k ;
+					break ;
+				default:
+					break ;
+			}
+		}
+		if ( Obad ) {
+			char Omsg[128] ;
+			snprintf(Omsg, sizeof(Omsg), "Sink batch %zu: %llu of %zu rows failed, first at row %llu of the batch",
+				b, (unsigned long long)Obad, n, (unsigned long long)Ofirst + 1) ;
+			ex_err(SQL_HANDLE_STMT, Ist, 437, Omsg);
+		}
+		St.rows += Ook ;
+		if ( Icommit && b % Icommit == 0 && !SQL_SUCCEEDED(Oret=SQLEndTran(SQL_HANDLE_DBC, Icon, SQL_COMMIT)) ) {
+			ex_err(SQL_HANDLE_DBC, Icon, 417, "Error committing");
+		}
+		return Ook ;
+	}
+
+	// Sink mode: write the partition rows through the parameterized query, "Ibatch" rows per
+	// SQLExecute. Each instance writes over its own connection; a failed partition is rolled back
+	// to the last commit when the connection is released.
+	void sinkPartition(ServerInterface &srvInterface, PartitionReader &inputReader, PartitionWriter &outputWriter)
+	{
+		SQLRETURN Oret = 0 ;
+		size_t n = 0, b = 0 ;
+		vint rows = 0 ;
+
+		do {
+			paramRow(inputReader, n) ;
+			if ( ++n == Ibatch ) {
+				rows += (vint)sinkBatch(n, ++b) ;
+				n = 0 ;
+			}
+		} while ( inputReader.next() && !canceled() ) ;
+		if ( n && !canceled() )
+			rows += (vint)sinkBatch(n, ++b) ;
+		if ( n != Ibatch && !SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ist, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)Ibatch, 0)) ) {
+			ex_err(SQL_HANDLE_STMT, Ist, 415, "Error setting statement attribute SQL_ATTR_PARAMSET_SIZE");
+		}
+		if ( canceled() )
+			return ;
+		if (!SQL_SUCCEEDED(Oret=SQLEndTran(SQL_HANDLE_DBC, Icon, SQL_COMMIT))) {
+			ex_err(SQL_HANDLE_DBC, Icon, 417, "Error committing");
+		}
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK sink %lld rows in %zu batches", (long long)rows, b);
+#endif
+		outputWriter.setInt(0, rows) ;
+		outputWriter.next() ;
+	}
+
+	// Script mode: run the script statements in order over the instance connection, one result
+	// row per statement. Repeated statements are prepared once and executed as many times as
+	// they appear. A failing statement stops the script; with "transaction" the statements run
+	// in one transaction, committed at the end (rolled back on errors when the connection is
+	// released).
+	void scriptPartition(ServerInterface &srvInterface, PartitionWriter &outputWriter)
+	{
+		SQLRETURN Oret = 0 ;
+		char Omsg[64] ;
+
+		if ( Itx && !SQL_SUCCEEDED(Oret=SQLSetConnectAttr(Icon, SQL_ATTR_AUTOCOMMIT, (SQLPOINTER)SQL_AUTOCOMMIT_OFF, 0)) ) {
+			ex_err(SQL_HANDLE_DBC, Icon, 422, "Error setting autocommit off");
+		}
+		for ( size_t i = 0 ; i < ctx->script.size() && !canceled() ; i++ ) {
+			const std::string &stmt = ctx->script[i] ;
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+			SQLHSTMT Oh = Ist ;
+			SQLLEN Orows = -1 ;
+
+			if ( ctx->script_rep[i] ) {
+				SQLHSTMT &Op = Iprep[stmt] ;
+				if ( !Op ) {
+					if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, Icon, &Op))) {
+						ex_err(SQL_HANDLE_DBC, Icon, 423, "Error allocating Statement Handle");
+					}
+					if ( Itimeout )
+						(void)SQLSetStmtAttr(Op, SQL_ATTR_QUERY_TIMEOUT, (SQLPOINTER)Itimeout, 0) ;
+					if (!SQL_SUCCEEDED(Oret=SQLPrepare(Op, (SQLCHAR *)stmt.c_str(), SQL_NTS))) {
+						snprintf(Omsg, sizeof(Omsg), "Error preparing script statement %zu", i + 1) ;
+						ex_err(SQL_HANDLE_STMT, Op, 424, Omsg);
+					}
+				}
+				Oh = Op ;
+			}
+			if (!SQL_SUCCEEDED(Oret=timedExecute(Oh, ctx->script_rep[i] ? NULL : stmt.c_str())) && Oret != SQL_NO_DATA ) {
+				snprintf(Omsg, sizeof(Omsg), "Error executing script statement %zu", i + 1) ;
+				ex_err(SQL_HANDLE_STMT, Oh, 425, Omsg);
+			}
+			if ( Oret == SQL_NO_DATA || !SQL_SUCCEEDED(SQLRowCount(Oh, &Orows)) )
+				Orows = -1 ;
+			(void)SQLFreeStmt(Oh, SQL_CLOSE) ;		// result sets are discarded
+			St.rows += Orows > 0 ? (size_t)Orows : 0 ;
+
+			// Statement text: blanks collapsed, cut on a UTF-8 character boundary
+			std::string Osql = cache_query(stmt) ;
+			if ( Osql.size() > SCRIPT_SQL_LEN ) {
+				size_t n = SCRIPT_SQL_LEN ;
+				while ( n && ( Osql[n] & 0xC0 ) == 0x80 )
+					n-- ;
+				Osql.resize(n) ;
+			}
+			outputWriter.setInt(0, (vint)(i + 1)) ;
+			outputWriter.getStringRef(1).copy(Osql) ;
+			if ( Orows < 0 )
+				outputWriter.setNull(2) ;
+			else
+				outputWriter.setInt(2, (vint)Orows) ;
+			outputWriter.setFloat(3, secs_since(t0)) ;
+			outputWriter.getStringRef(4).copy(Oret == SQL_SUCCESS ? "SUCCESS" :
+				Oret == SQL_SUCCESS_WITH_INFO ? "SUCCESS_WITH_INFO" : "NO_DATA") ;
+			outputWriter.next() ;
+		}
+		if ( Itx && !canceled() && !SQL_SUCCEEDED(Oret=SQLEndTran(SQL_HANDLE_DBC, Icon, SQL_COMMIT)) ) {
+			ex_err(SQL_HANDLE_DBC, Icon, 426, "Error committing the script");
+		}
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK script %zu statements, %zu prepared, transaction=%d", ctx->script.size(), Iprep.size(), (int)Itx);
+#endif
+	}
+
+	// Free the instance statement and give its connection back (canceled ones are closed):
+	void cleanInstance()
+	{
+		for ( std::map<std::string, SQLHSTMT>::iterator it = Iprep.begin() ; it != Iprep.end() ; ++it )
+			(void)SQLFreeHandle(SQL_HANDLE_STMT, it->second);
+		Iprep.clear() ;
+		if ( Ist ) {
+			(void)SQLFreeHandle(SQL_HANDLE_STMT, Ist);
+			Ist = 0 ;
+		}
+		if ( Icon ) {
+			registry.release(ctx->connstr, Icon, ctx->pooling && !canceled());
+			Icon = 0 ;
+		}
+	}
+
+	virtual void setup(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+	{
+		SQLRETURN Oret = 0 ;
+		SQLHSTMT Ostmt = 0 ;
+		SQLHDBC Ocur = 0 ;
+		SQLCHAR Obuff[64];
+
+		memset(&Obuff[0], 0, sizeof(Obuff));
+		Icancel.store(false) ;
+		Icon = 0 ;
+		Ist = 0 ;
+		Ishard = NULL ;
+		Iwm = -1 ;
+		Iplan = NULL ;
+		Ocopies = 0 ;
+
+		// Description built by the factory for this call (described again if not found, for
+		// example when it expired, or on the other nodes from the COPY source plan):
+		if ( !( ctx = contexts.get(context_key(srvInterface)) ) ) {
+			SizedColumnTypes outputTypes ;
+			ctx = describe(srvInterface, outputTypes, argTypes.getColumnCount(), Iplanned) ;
+		}
+		Oncol = ctx->Oncol ;
+
+		// The first instance gets the describe connection and its prepared statement, the
+		// others (and split mode slices) their own connection:
+		St = Stats() ;
+		St.cids = ctx->stats.cids ;
+		St.describe = ctx->stats.describe ;
+		if ( ctx->cache ) {		// result set from the local cache: nothing to set up
+			ParamReader params = srvInterface.getParamReader();
+			Istatsfile = params.containsParameter("stats_file") ? params.getStringRef("stats_file").str() : "" ;
+			return ;
+		}
+		Iprepared = ctx->take(Icon, Ist) ;
+		if ( Iprepared ) {
+			St.connect = ctx->stats.connect ;
+			St.admit = ctx->stats.admit ;
+			St.queued = ctx->stats.queued ;
+		} else {
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+			double waited = 0 ;
+			Icon = registry.connect(ctx->connstr, ctx->admission(0), 204, &waited) ;
+			St.connect = secs_since(t0) ;
+			St.wait(waited) ;
+			if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, Icon, &Ist))){
+				ex_err(SQL_HANDLE_DBC, Icon, 208, "Error allocating Statement Handle");
+			}
+			if ( ctx->profile )
+				stream_stmt(Ist) ;
+		}
+		Ocur = Icon ;
+
+		// Check the DBMS we are connecting to:
+		if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, Ocur, &Ostmt))){
+			ex_err(SQL_HANDLE_DBC, Ocur, 201, "Error allocating Statement Handle");
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLGetInfo(Ocur, SQL_DBMS_NAME,
+        	(SQLPOINTER)Obuff, (SQLSMALLINT)sizeof(Obuff), NULL))) {
+			ex_err(SQL_HANDLE_DBC, Ocur, 202, "Error getting remote DBMS Name");
+    	}
+		dbt = dbms_type((char *)Obuff) ;
+
+		// Type probe: drivers not supporting SQL_C_SBIGINT (older Oracle drivers) accept the
+		// binding and fail on fetch, so fetch a constant into it, once per connection string.
+		// Integers are bound as strings when any step fails. Other DBMSs have no common constant
+		// query and their drivers support SQL_C_SBIGINT:
+		Ibigint = true ;
+		if ( dbt == ORACLE && !registry.bigint(ctx->connstr, Ibigint) ) {
+			SQLBIGINT Ov = 0 ;
+			SQLLEN Ovl = 0 ;
+			Ibigint = SQL_SUCCEEDED(SQLExecDirect(Ostmt, (SQLCHAR *)"SELECT 1 FROM DUAL", SQL_NTS)) &&
+				SQL_SUCCEEDED(SQLBindCol(Ostmt, 1, SQL_C_SBIGINT, &Ov, sizeof(Ov), &Ovl)) &&
+				SQL_SUCCEEDED(SQLFetch(Ostmt)) && Ovl != SQL_NULL_DATA ;
+			(void)SQLFreeStmt(Ostmt, SQL_CLOSE) ;
+			(void)SQLFreeStmt(Ostmt, SQL_UNBIND) ;
+			registry.learn_bigint(ctx->connstr, Ibigint) ;
+		}
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK DBMS=<%s> type=%d SQL_C_SBIGINT=%d", (char *)Obuff, (int)dbt, (int)Ibigint );
+#endif
+		Igdext = 0 ;
+		if (!SQL_SUCCEEDED(Oret=SQLGetInfo(Ocur, SQL_GETDATA_EXTENSIONS,
+			(SQLPOINTER)&Igdext, (SQLSMALLINT)sizeof(Igdext), NULL))) {
+			Igdext = 0 ;
+		}
+		SQLUINTEGER Oam = SQL_AM_NONE ;
+		if (!SQL_SUCCEEDED(Oret=SQLGetInfo(Ocur, SQL_ASYNC_MODE,
+			(SQLPOINTER)&Oam, (SQLSMALLINT)sizeof(Oam), NULL))) {
+			Oam = SQL_AM_NONE ;
+		}
+        (void)SQLFreeHandle(SQL_HANDLE_STMT, Ostmt);
+
+		// Read/Set rowset Params (fetch_buffer_mb rowset is computed in processPartition):
+		ParamReader params = srvInterface.getParamReader();
+		Ifetchmb = 0 ;
+		if( params.containsParameter("fetch_buffer_mb") ) {
+			vint mb_param = params.getIntRef("fetch_buffer_mb") ;
+			if ( params.containsParameter("rowset") ) {
+				vt_report_error(211, "DBLINK. rowset and fetch_buffer_mb are mutually exclusive");
+			} else if ( mb_param < 1 || mb_param > MAX_FETCH_BUFFER_MB ) {
+				vt_report_error(212, "DBLINK. fetch_buffer_mb out of range [1, %d]", MAX_FETCH_BUFFER_MB);
+			}
+			Ifetchmb = (size_t) mb_param ;
+			rowset = DEF_ROWSET ;
+		} else if( params.containsParameter("rowset") ) {
+			vint rowset_param = params.getIntRef("rowset") ;
+			if ( rowset_param < 1 || rowset_param > MAX_ROWSET ) {
+				ex_err(0, 0, 203, "DBLINK. Error rowset out of range");
+			} else {
+				rowset = (size_t) rowset_param ;
+			}
+		} else {
+			rowset = DEF_ROWSET ;
+		}
+
+		Iadapt = params.containsParameter("rowset_adaptive") && params.getBoolRef("rowset_adaptive") == VTrue ;
+		Ilobs = !params.containsParameter("lob_stream") || params.getBoolRef("lob_stream") != VFalse ;
+		Istatsfile = params.containsParameter("stats_file") ? params.getStringRef("stats_file").str() : "" ;
+		Inumnative = params.containsParameter("numeric_native") && params.getBoolRef("numeric_native") == VTrue ;
+		Itrunc = 0 ;
+
+		// Asynchronous execution (statement level only) and query_timeout. The timeout is also
+		// passed to the driver, which enforces it on synchronous executions:
+		Iasync = Oam == SQL_AM_STATEMENT && ( !params.containsParameter("async") || params.getBoolRef("async") != VFalse ) ;
+		Itimeout = 0 ;
+		if( params.containsParameter("query_timeout") ) {
+			vint timeout_param = params.getIntRef("query_timeout") ;
+			if ( timeout_param < 0 ) {
+				vt_report_error(224, "DBLINK. query_timeout must be >= 0");
+			}
+			Itimeout = (size_t) timeout_param ;
+			if ( Itimeout && !SQL_SUCCEEDED(Oret=SQLSetStmtAttr(Ist, SQL_ATTR_QUERY_TIMEOUT, (SQLPOINTER)Itimeout, 0)) ) {
+				srvInterface.log("DBLINK driver does not support SQL_ATTR_QUERY_TIMEOUT%s", Iasync ? "" : ": query_timeout ignored");
+			}
+		}
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK SQL_ASYNC_MODE=%u async=%d query_timeout=%zu", (unsigned int)Oam, (int)Iasync, Itimeout );
+#endif
+
+		// Read timestamptz Param:
+		Itzoff = 0 ;
+		if( params.containsParameter("timestamptz") &&
+				!parse_utc_offset(params.getStringRef("timestamptz").str(), Itzoff) ) {
+			vt_report_error(210, "DBLINK. Invalid timestamptz UTC offset <%s>", params.getStringRef("timestamptz").str().c_str());
+		}
+
+		// Read/Set pipeline Param:
+		nbuf = 1 ;
+		Ooff = 0 ;
+		if( params.containsParameter("pipeline") ) {
+			vint pipeline_param = params.getIntRef("pipeline") ;
+			if ( pipeline_param < 0 || pipeline_param == 1 || pipeline_param > MAX_PIPELINE ) {
+				vt_report_error(209, "DBLINK. pipeline must be 0 (disabled) or between 2 and %d", MAX_PIPELINE);
+			} else if ( pipeline_param > 1 ) {
+				nbuf = (size_t) pipeline_param ;
+			}
+		}
+		if ( ctx->chunk_rows )			// chunks are fetched one rowset at a time
+			nbuf = 1 ;
+
+		// Sink mode: the statement is prepared once and its parameters bound to the input columns
+		if ( ctx->mode == MODE_SINK ) {
+			if ( !Iprepared && !SQL_SUCCEEDED(Oret=SQLPrepare(Ist, (SQLCHAR *)ctx->query.c_str(), SQL_NTS)) ) {
+				ex_err(SQL_HANDLE_STMT, Ist, 213, "Error preparing the sink statement");
+			}
+			sinkSetup(srvInterface, argTypes) ;
+		} else if ( ctx->mode == MODE_LOOKUP ) {
+			lookupSetup(srvInterface, argTypes) ;
+		} else if ( !ctx->wm_value.empty() && !ctx->chunk_rows ) {
+			// Incremental extraction: the saved watermark, converted by the remote DBMS
+			const ColPlan &cp = ctx->Oplan[ctx->wm_idx] ;
+			Iwmlen = SQL_NTS ;
+			if (!SQL_SUCCEEDED(Oret=SQLBindParameter(Ist, 1, SQL_PARAM_INPUT, SQL_C_CHAR, cp.sqlt, cp.size, cp.decimals,
+					(SQLPOINTER)ctx->wm_value.c_str(), 0, &Iwmlen))) {
+				ex_err(SQL_HANDLE_STMT, Ist, 225, "Error binding the watermark parameter");
+			}
+		}
+		Iwm = ctx->wm_idx ;
+		Iwmset = false ;
+		Iretries = DEF_CHUNK_RETRIES ;
+		if( params.containsParameter("chunk_retries") ) {
+			vint retries_param = params.getIntRef("chunk_retries") ;
+			if ( retries_param < 0 || retries_param > MAX_CHUNK_RETRIES ) {
+				vt_report_error(226, "DBLINK. chunk_retries out of range [0, %d]", MAX_CHUNK_RETRIES);
+			}
+			Iretries = (size_t) retries_param ;
+		}
+		Itx = ctx->mode == MODE_SCRIPT && params.containsParameter("transaction") && params.getBoolRef("transaction") == VTrue ;
+	}
+
+    virtual void cancel(ServerInterface &srvInterface)
+    {
+		SQLRETURN Oret = 0 ;
+		Icancel.store(true, std::memory_order_release) ;
+		if ( Ist ) {
+			if (!SQL_SUCCEEDED(Oret=SQLCancel(Ist)))
+				ex_err(SQL_HANDLE_STMT, Ist, 301, "Error canceling SQL statement");
+        }
+    }
+
+    virtual void destroy(ServerInterface &srvInterface, const SizedColumnTypes &argTypes)
+    {
+		cleanInstance() ;
+		// Instances live in the UDx allocator memory and might not be destructed:
+		ctx.reset() ;
+		std::vector<char>().swap(Ilob) ;
+		std::vector<char>().swap(Iwide) ;
+		std::unordered_set<std::string>().swap(Iseen) ;
+		std::string().swap(Iplanned) ;
+    }
 
-				// Execute Stateent:
-				if (!SQL_SUCCEEDED(Oret=SQLExecute(Ost)) && Oret != SQL_NO_DATA ) {
-					ex_err(SQL_HANDLE_STMT, Ost, 403, "Error executing the statement");
-				}
+    virtual void processPartition(ServerInterface &srvInterface,
+                                  PartitionReader & inputReader,
+                                  PartitionWriter & outputWriter)
+	{
+		SQLRETURN Oret = 0 ;
 
-				// Fetch loop:
-				while ( SQL_SUCCEEDED(Oret=SQLFetchScroll(Ost, SQL_FETCH_NEXT, 0)) && !isCanceled() ) {
-					for ( unsigned int i = 0 ; i < nfr ; i++, outputWriter.next() ) {
-						for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
-							Odp = (SQLPOINTER)((uint8_t *)Ores[j] + desz[j] * i) ;
-							Odl = Olen[j][i] ;
-							
-							if ( (int)Odl == (int)SQL_NULL_DATA ) {
-								outputWriter.setNull(j) ;
-								continue ;
-							}
+		try
+		{
+			if ( ctx->cache ) {
+				replayCache(outputWriter) ;
+			} else if ( ctx->mode == MODE_SINK ) {
+				sinkPartition(srvInterface, inputReader, outputWriter) ;
+			} else if ( ctx->mode == MODE_SCRIPT ) {
+				scriptPartition(srvInterface, outputWriter) ;
+			} else if ( !ctx->shards.empty() ) {
+				shardPartition(srvInterface, inputReader, outputWriter) ;
+			} else if ( ctx->is_select ) {
+				// Asynchronous execution: the remote database runs the query while the buffers
+				// are planned and allocated (columns are bound once it is done)
+				const char *query = Iprepared ? NULL : ctx->query.c_str() ;
+				bool overlap = Iasync && ctx->mode == MODE_QUERY && ctx->split_col.empty() && !ctx->chunk_rows ;
+				if ( overlap )
+					Oret = beginExecute(Ist, query) ;
 
-							
-							switch(Odt[j]) {
-								case SQL_SMALLINT:
-								case SQL_INTEGER:
-								case SQL_TINYINT:
-								case SQL_BIGINT:
-									if ( dbt == ORACLE ) {
-										outputWriter.setInt(j, ((int)Odl == SQL_NTS) ? vint_null : (vint)atoll((char *)Odp) ) ;
-									} else {
-										outputWriter.setInt(j, *(SQLBIGINT *)Odp) ;
-									}
-									break ;
-								case SQL_REAL:
-								case SQL_DOUBLE:
-								case SQL_FLOAT:
-									outputWriter.setFloat(j, *(SQLDOUBLE *)Odp) ;
-									break ;
-								case SQL_NUMERIC:
-								case SQL_DECIMAL:
-									{
-										std::string rejectReason = "Unrecognized remote database format" ;
-										if ( *(char *)Odp == '\0' ) { // some DBs might use empty strings for NUMERIC nulls
-											outputWriter.setNull(j) ;
-										} else {
-
-											if (!parser.parseNumeric((char*)Odp, (size_t)Odl, j,
-													outputWriter.getNumericRef(j), colInfo.getColumnType(j), rejectReason)) {
-												ex_err(0, 0, 404, "Error parsing Numeric");
-											}
-										}
-										break ;
-									}
-								case SQL_CHAR:
-								case SQL_WCHAR:
-								case SQL_VARCHAR:
-								case SQL_WVARCHAR:
-								case SQL_LONGVARCHAR:
-								case SQL_WLONGVARCHAR:
-								case SQL_BINARY:
-								case SQL_VARBINARY:
-								case SQL_LONGVARBINARY:
-									if ( (int)Odl == SQL_NTS )
-										Odl = (SQLULEN)strnlen((char *)Odp , desz[j]);
-									outputWriter.getStringRef(j).copy((char *)Odp, Odl ) ;
-									break ;
-								case SQL_TYPE_TIME:
-									{
-										SQL_TIME_STRUCT &st = *(SQL_TIME_STRUCT *)Odp ;
-										outputWriter.setTime(j, getTimeFromUnixTime(st.second + st.minute * 60 + st.hour * 3600 ) );
-										break ;
-									}
-								case SQL_TYPE_DATE:
-									{
-										SQL_DATE_STRUCT &sd = *(SQL_DATE_STRUCT *)Odp ;
-										struct tm d = { 0, 0, 0, sd.day, sd.month - 1, sd.year - 1900, 0, 0, -1 } ;
-										time_t utime = mktime ( &d ) ;
-										outputWriter.setDate(j, getDateFromUnixTime(utime + d.tm_gmtoff) ) ;
-										break ;
-									}
-								case SQL_TYPE_TIMESTAMP:
-									{
-										SQL_TIMESTAMP_STRUCT &ss = *(SQL_TIMESTAMP_STRUCT *)Odp ;
-										struct tm ts = { ss.second, ss.minute, ss.hour, ss.day, ss.month - 1, ss.year - 1900, 0, 0, -1 } ;
-										time_t utime = mktime ( &ts ) ;
-										outputWriter.setTimestamp(j, getTimestampFromUnixTime(utime + ts.tm_gmtoff) + ss.fraction / 1000 ) ;
-										break ;
-									}
-								case SQL_BIT:
-									outputWriter.setBool(j, *(SQLCHAR *)Odp == SQL_TRUE ? VTrue : VFalse);
-									break ;
-								case SQL_INTERVAL_YEAR_TO_MONTH: // Vertica stores these Intervals as durations in months
-									{
-                        				SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT*)Odp;
-										if (intv.interval_type != SQL_IS_YEAR_TO_MONTH) {
-											ex_err(0, 0, 405, "Unsupported INTERVAL data type. Expecting SQL_IS_YEAR_TO_MONTH");
-										}
-										Interval ret = (  (intv.intval.year_month.year*MONTHS_PER_YEAR)
-														+ (intv.intval.year_month.month))
-														* (intv.interval_sign == SQL_TRUE ? -1 : 1);
-										outputWriter.setInterval(j, ret);
-										break ;
-									}
-								case SQL_INTERVAL_DAY_TO_SECOND: // Vertica stores these Intervals as durations in microseconds
-									{
-                        				SQL_INTERVAL_STRUCT &intv = *(SQL_INTERVAL_STRUCT*)Odp;
-										if (intv.interval_type != SQL_IS_DAY_TO_SECOND) {
-											ex_err(0, 0, 406, "Unsupported INTERVAL data type. Expecting SQL_IS_DAY_TO_SECOND");
-										}
-										
-										Interval ret = (  (intv.intval.day_second.day*usPerDay)
-														+ (intv.intval.day_second.hour*usPerHour)
-														+ (intv.intval.day_second.minute*usPerMinute)
-														+ (intv.intval.day_second.second*usPerSecond)
-														+ (intv.intval.day_second.fraction/1000))
-														* (intv.interval_sign == SQL_TRUE ? -1 : 1);
-										outputWriter.setInterval(j, ret);
-										break ;
-									}
-								default:
-									vt_report_error(407, "DBLINK. Unsupported data type for column %u", j);
-									break ;
-							}
-						}
+				buildPlan(srvInterface) ;
+				allocBuffers(srvInterface, nbuf) ;
+				if ( overlap && !SQL_SUCCEEDED(Oret=endExecute(Ist, query, Oret)) && Oret != SQL_NO_DATA ) {
+					ex_err(SQL_HANDLE_STMT, Ist, 403, "Error executing the statement");
+				}
+				bindColumns(Ist, nbuf > 1 ? &Ooff : NULL, &nfr) ;
+
+				if ( ctx->mode == MODE_LOOKUP ) {
+					lookupPartition(inputReader, outputWriter) ;
+				} else if ( ctx->chunk_rows ) {
+					fetchChunks(srvInterface, outputWriter) ;
+				} else if ( ctx->split_col.empty() ) {
+					// Execute Stateent:
+					if ( !overlap && !SQL_SUCCEEDED(Oret=timedExecute(query)) && Oret != SQL_NO_DATA ) {
+						ex_err(SQL_HANDLE_STMT, Ist, 403, "Error executing the statement");
+					}
+					if ( ctx->cache_path.empty() ) {
+						fetchRows(outputWriter) ;
+						(void)SQLFreeStmt(Ist, SQL_CLOSE) ;		// next partition executes it again
+						if ( Iwm >= 0 )
+							saveWatermark(srvInterface) ;
+					} else {
+						CacheWriter cacheWriter(outputWriter, ctx->Oplan, ctx->colInfo, ctx->cache_max) ;
+						fetchRows(cacheWriter) ;
+						(void)SQLFreeStmt(Ist, SQL_CLOSE) ;
+						saveCache(srvInterface, cacheWriter) ;
+					}
+				} else if ( inputReader.getNumCols() == 0 ) {
+					// No slice numbers in input: extract all slices here
+					for ( size_t s = 0 ; s <= ctx->split_cuts.size() && !canceled() ; s++ )
+						fetchSlice(srvInterface, ctx->split_query(s), outputWriter) ;
+				} else if ( inputReader.getNumCols() >= 2 ) {
+					// Each input row carries the bounds of a slice to extract (NULL: open)
+					do {
+						fetchSlice(srvInterface, ctx->range_query(sliceBound(inputReader, 0), sliceBound(inputReader, 1)), outputWriter) ;
+					} while ( inputReader.next() && !canceled() ) ;
+				} else {
+					// Each input row carries the number of a slice to extract
+					if ( !inputReader.getTypeMetaData().getColumnType(0).isInt() ) {
+						ex_err(0, 0, 409, "Split mode expects slice numbers (INTEGER) as first input column");
 					}
+					do {
+						if ( inputReader.isNull(0) )
+							continue ;
+						vint s = inputReader.getIntRef(0) ;
+						if ( s < 0 || (size_t)s > ctx->split_cuts.size() ) {
+							vt_report_error(410, "DBLINK. Slice %lld out of range [0, %zu]", (long long)s, ctx->split_cuts.size());
+						}
+						fetchSlice(srvInterface, ctx->split_query((size_t)s), outputWriter) ;
+					} while ( inputReader.next() && !canceled() ) ;
+				}
+				if ( Itrunc ) {
+					srvInterface.log("DBLINK %zu long/wide column values truncated to the column length", Itrunc);
 				}
 			} else {
-				if (!SQL_SUCCEEDED(Oret=SQLExecDirect (Ost, (SQLCHAR *)query.c_str(), SQL_NTS))) {
-					ex_err(SQL_HANDLE_STMT, Ost, 408, "Error executing statement");
+				if (!SQL_SUCCEEDED(Oret=timedExecute(ctx->query.c_str()))) {
+					ex_err(SQL_HANDLE_STMT, Ist, 408, "Error executing statement");
 				}
 				outputWriter.setInt(0, (vint)Oret) ;
 				outputWriter.next() ;
 			}
-			clean() ;
+			reportStats(srvInterface) ;
 		}
 		catch (exception& e)
 		{
-			clean();
+			reportStats(srvInterface) ;		// the phases run before the error
+			cleanInstance() ;
 			vt_report_error(400, "Exception while processing partition: [%s]", e.what());
 		}
 	}
 };
 
-class DBLinkFactory : public TransformFunctionFactory
+// Add the Vertica column planned by describe() for a remote column
+void add_column ( SizedColumnTypes &outputTypes, const ColPlan &cp, const std::string &cname )
 {
-	virtual void getPrototype(ServerInterface &srvInterface,
-                              ColumnTypes &argTypes,
-                              ColumnTypes &returnType )
-	{
-		returnType.addAny();
+	switch ( cp.sqlt ) {
+		case SQL_SMALLINT:
+		case SQL_INTEGER:
+		case SQL_TINYINT:
+		case SQL_BIGINT:
+			outputTypes.addInt(cname) ;
+			break ;
+		case SQL_REAL:
+		case SQL_DOUBLE:
+		case SQL_FLOAT:
+			outputTypes.addFloat(cname) ;
+			break ;
+		case SQL_NUMERIC:
+		case SQL_DECIMAL:
+			outputTypes.addNumeric((int32)cp.size, (int32)cp.decimals, cname) ;
+			break ;
+		case SQL_CHAR:
+		case SQL_WCHAR:
+			outputTypes.addChar((int32)cp.size, cname) ;
+			break ;
+		case SQL_VARCHAR:
+		case SQL_WVARCHAR:
+			outputTypes.addVarchar((int32)cp.size, cname) ;
+			break ;
+		case SQL_LONGVARCHAR:
+		case SQL_WLONGVARCHAR:
+			outputTypes.addLongVarchar((int32)cp.size, cname) ;
+			break ;
+		case SQL_TYPE_TIME:
+			outputTypes.addTime((int32)cp.decimals, cname) ;
+			break ;
+		case SQL_TYPE_DATE:
+			outputTypes.addDate(cname) ;
+			break ;
+		case SQL_TYPE_TIMESTAMP:
+			if ( cp.kind == CK_TIMESTAMPTZ )
+				outputTypes.addTimestampTz((int32)cp.decimals, cname) ;
+			else
+				outputTypes.addTimestamp((int32)cp.decimals, cname) ;
+			break ;
+		case SQL_BIT:
+			outputTypes.addBool(cname) ;
+			break ;
+		case SQL_BINARY:
+			outputTypes.addBinary((int32)cp.size, cname) ;
+			break ;
+		case SQL_VARBINARY:
+			outputTypes.addVarbinary((int32)cp.size, cname) ;
+			break ;
+		case SQL_LONGVARBINARY:
+			outputTypes.addLongVarbinary((int32)cp.size, cname) ;
+			break ;
+		case SQL_INTERVAL_YEAR_TO_MONTH:
+			outputTypes.addIntervalYM(INTERVAL_YEAR2MONTH, cname) ;
+			break ;
+		case SQL_INTERVAL_DAY_TO_SECOND:
+			outputTypes.addInterval((int32)cp.decimals, INTERVAL_DAY2SECOND, cname) ;
+			break ;
 	}
-	virtual void getReturnType(ServerInterface &srvInterface,
-                               const SizedColumnTypes &inputTypes,
-                               SizedColumnTypes &outputTypes )
-	{
-		SQLRETURN Oret = 0 ;
-		SQLSMALLINT Onamel = 0 ;
-		SQLSMALLINT Onull = 0 ;
-		SQLCHAR Ocname[MAXCNAMELEN] ;
-		std::string cid = "" ;
-		std::string cid_env = "" ;
-		std::string cid_file = DBLINK_CIDS ;
-		std::string cid_name = "" ;
-		std::string cid_value = "" ;
-		bool connect = false ;
-
-		// Read Params:
-		ParamReader params = srvInterface.getParamReader();
-		if( params.containsParameter("cidfile") ) {			// Start checking "cidfile" param
-			cid_file = params.getStringRef("cidfile").str() ;
+}
+
+// Describe a DBLINK call from its local cache entry: same columns, no connection. Returns
+// false if there is no valid entry.
+bool describe_cached ( std::shared_ptr<Context> &ctx, SizedColumnTypes &outputTypes, int64 ttl )
+{
+	std::shared_ptr<CacheFile> cf = std::make_shared<CacheFile>() ;
+	if ( !cf->open(ctx->cache_path, ctx->cache_hash, ttl) )
+		return false ;
+	for ( uint32 j = 0 ; j < cf->head->ncol ; j++ ) {
+		const CacheCol &c = cf->cols[j] ;
+		ColPlan cp ;
+		cp.sqlt = c.sqlt ;
+		cp.size = (SQLULEN)c.size ;
+		cp.decimals = c.decimals ;
+		cp.set(0, SQL_C_DEFAULT, (ColKind)c.kind) ;
+		if ( c.kind < 0 || c.kind >= CK_KINDS || cache_width(cp) != c.width ) {
+			ctx->Oplan.clear() ;
+			return false ;
+		}
+		ctx->Oplan.push_back(cp) ;
+	}
+	for ( uint32 j = 0 ; j < cf->head->ncol ; j++ )
+		add_column(outputTypes, ctx->Oplan[j], std::string(cf->at(cf->cols[j].name), cf->cols[j].namelen)) ;
+	ctx->Oncol = (SQLUSMALLINT)cf->head->ncol ;
+	ctx->colInfo = outputTypes ;
+	ctx->cache = cf ;
+	ctx->cache_path.clear() ;
+	return true ;
+}
+
+// Describe cache (describe_ttl): the column plans of a SELECT, saved by a call describing it
+// and read by the next ones until the entry is "ttl" seconds old, so that planning the query
+// costs no remote round trip. A text file per connection/query/options, replaced atomically:
+// a header line with its creation time, then "sqlt size decimals desz ctype kind name" lines.
+bool describe_read ( std::istream &f, int64 ttl, Context &ctx, SizedColumnTypes &outputTypes )
+{
+	std::string magic ;
+	long long created = 0 ;
+	size_t ncol = 0 ;
+	std::vector<ColPlan> plan ;
+	std::vector<std::string> names ;
+
+	if ( !( f >> magic >> created >> ncol ) || magic != "DBLINK-DESCRIBE-1" || ( ttl >= 0 && created + ttl <= (int64)time(NULL) ) ||
+			ncol == 0 || ncol > 65535 || f.get() != '\n' )
+		return false ;
+	for ( size_t j = 0 ; j < ncol ; j++ ) {
+		ColPlan cp ;
+		int sqlt, decimals, ctype, kind ;
+		unsigned long long size, desz ;
+		std::string name ;
+		if ( !( f >> sqlt >> size >> decimals >> desz >> ctype >> kind ) || kind < 0 || kind >= CK_KINDS ||
+				f.get() != ' ' || !std::getline(f, name) )
+			return false ;
+		cp.sqlt = (SQLSMALLINT)sqlt ;
+		cp.size = (SQLULEN)size ;
+		cp.decimals = (SQLSMALLINT)decimals ;
+		cp.set((size_t)desz, (SQLSMALLINT)ctype, (ColKind)kind) ;
+		plan.push_back(cp) ;
+		names.push_back(name) ;
+	}
+	for ( size_t j = 0 ; j < ncol ; j++ )
+		add_column(outputTypes, plan[j], names[j]) ;
+	ctx.Oplan.swap(plan) ;
+	ctx.Oncol = (SQLUSMALLINT)ncol ;
+	return true ;
+}
+
+// Text of the description, empty if a column name cannot be saved
+std::string describe_text ( const Context &ctx, const SizedColumnTypes &outputTypes )
+{
+	std::string body = "DBLINK-DESCRIBE-1 " + std::to_string((long long)time(NULL)) + " " + std::to_string((long long)ctx.Oncol) + "\n" ;
+
+	for ( unsigned int j = 0 ; j < ctx.Oncol ; j++ ) {
+		const ColPlan &cp = ctx.Oplan[j] ;
+		std::string name = outputTypes.getColumnName(j) ;
+		if ( name.find('\n') != std::string::npos )
+			return "" ;
+		body += std::to_string((long long)cp.sqlt) + " " + std::to_string((unsigned long long)cp.size) + " " +
+			std::to_string((long long)cp.decimals) + " " + std::to_string((unsigned long long)cp.desz) + " " +
+			std::to_string((long long)cp.ctype) + " " + std::to_string((long long)cp.kind) + " " + name + "\n" ;
+	}
+	return body ;
+}
+
+bool describe_load ( const std::string &path, int64 ttl, Context &ctx, SizedColumnTypes &outputTypes )
+{
+	std::ifstream f(path) ;
+
+	return describe_read(f, ttl, ctx, outputTypes) ;
+}
+
+bool describe_save ( const std::string &path, const Context &ctx, const SizedColumnTypes &outputTypes )
+{
+	std::string body = describe_text(ctx, outputTypes) ;
+
+	if ( body.empty() )
+		return false ;
+	mkdirs(path.substr(0, path.rfind('/'))) ;
+	return file_replace(path, body) ;
+}
+
+// COPY source plan: the description made by the factory plan() on the initiator, followed by
+// the split cuts ("length value" lines, the values may hold any character). The sources of
+// every node read it instead of describing the query and probing the split column again.
+std::string plan_text ( const Context &ctx, const SizedColumnTypes &outputTypes )
+{
+	std::string body = describe_text(ctx, outputTypes) ;
+
+	if ( body.empty() )
+		return "" ;
+	body += std::to_string((long long)ctx.split_cuts.size()) + "\n" ;
+	for ( size_t i = 0 ; i < ctx.split_cuts.size() ; i++ )
+		body += std::to_string((long long)ctx.split_cuts[i].size()) + " " + ctx.split_cuts[i] + "\n" ;
+	return body ;
+}
+
+bool plan_read ( const std::string &text, Context &ctx, SizedColumnTypes &outputTypes )
+{
+	std::istringstream f(text) ;
+	size_t ncut = 0 ;
+
+	if ( !describe_read(f, -1, ctx, outputTypes) || !( f >> ncut ) || ncut >= MAX_SPLIT || f.get() != '\n' )
+		return false ;
+	for ( size_t i = 0 ; i < ncut ; i++ ) {
+		size_t len = 0 ;
+		std::string cut ;
+		if ( !( f >> len ) || f.get() != ' ' )
+			return false ;
+		cut.resize(len) ;
+		if ( !f.read(&cut[0], (std::streamsize)len) || f.get() != '\n' )
+			return false ;
+		ctx.split_cuts.push_back(cut) ;
+	}
+	return true ;
+}
+
+// Describe a DBLINK call with "ninput" input columns: resolve the connection, prepare the query
+// and plan the result set columns. The describe connection stays open (in the Context) for the
+// first instance. COPY sources pass the "planned" description and split of the initiator.
+std::shared_ptr<Context> describe ( ServerInterface &srvInterface, SizedColumnTypes &outputTypes, size_t ninput,
+	const std::string &planned )
+{
+	SQLRETURN Oret = 0 ;
+	SQLSMALLINT Onamel = 0 ;
+	SQLSMALLINT Onull = 0 ;
+	SQLCHAR Ocname[MAXCNAMELEN] ;
+	std::string cid = "" ;
+	std::string cid_env = "" ;
+	std::string cid_file = DBLINK_CIDS ;
+	std::string cid_value = "" ;
+	bool connect = false ;
+	std::shared_ptr<Context> ctx = std::make_shared<Context>() ;
+
+	// Read Params:
+	ParamReader params = srvInterface.getParamReader();
+	if( params.containsParameter("cidfile") ) {			// Start checking "cidfile" param
+		cid_file = params.getStringRef("cidfile").str() ;
 #ifdef DBLINK_DEBUG
   srvInterface.log("DEBUG DBLINK read param cidfile=<%s>", cid_file.c_str() );
 #endif
-		}
-		if( params.containsParameter("cid") ) {				// Start checking "cid" param
-			cid = params.getStringRef("cid").str() ;
+	}
+	if( params.containsParameter("cid") ) {				// Start checking "cid" param
+		cid = params.getStringRef("cid").str() ;
 #ifdef DBLINK_DEBUG
   srvInterface.log("DEBUG DBLINK read param cid=<%s>", cid.c_str() );
 #endif
-		} else if( params.containsParameter("connect_secret") ) {	// if "cid" is undef try with "connect_secret"
-			connect = true ;
-			cid = params.getStringRef("connect_secret").str() ;
-		} else if( params.containsParameter("connect") ) {	// if "cid" is undef try with "connect"
-			connect = true ;
-			cid = params.getStringRef("connect").str() ;
-		} else if (srvInterface.getUDSessionParamReader("library").containsParameter("dblink_secret")) {
-			// if "cid", "connect_secret" and "connect" are not defined try "dblink_secret" session param
-			connect = true ;
-			cid = srvInterface.getUDSessionParamReader("library").getStringRef("dblink_secret").str() ;
-		} else {
-			vt_report_error(101, "DBLINK. Missing connection parameters");
-		}
-		if( params.containsParameter("query") ) {
-			query = params.getStringRef("query").str() ;
+	} else if( params.containsParameter("connect_secret") ) {	// if "cid" is undef try with "connect_secret"
+		connect = true ;
+		cid = params.getStringRef("connect_secret").str() ;
+	} else if( params.containsParameter("connect") ) {	// if "cid" is undef try with "connect"
+		connect = true ;
+		cid = params.getStringRef("connect").str() ;
+	} else if (srvInterface.getUDSessionParamReader("library").containsParameter("dblink_secret")) {
+		// if "cid", "connect_secret" and "connect" are not defined try "dblink_secret" session param
+		connect = true ;
+		cid = srvInterface.getUDSessionParamReader("library").getStringRef("dblink_secret").str() ;
+	} else {
+		vt_report_error(101, "DBLINK. Missing connection parameters");
+	}
+	if( params.containsParameter("query") ) {
+		ctx->query = params.getStringRef("query").str() ;
 #ifdef DBLINK_DEBUG
-  srvInterface.log("DEBUG DBLINK read param query=<%s>", query.c_str() );
+  srvInterface.log("DEBUG DBLINK read param query=<%s>", ctx->query.c_str() );
 #endif
-		} else {
-			vt_report_error(102, "DBLINK. Missing query parameter");
-		}
-
-		// Check connection parameters
-		if ( connect ) { 	// old VFQ connect style: connect='@/tmp/file.txt' will read CIDs from a different file
-			if ( cid[0] == '@' ) {
-				std::ifstream cids(cid.substr(1)) ;
-				if ( cids.is_open() ) {
-					std::stringstream ssFile;
-					ssFile << cids.rdbuf() ;
-					cid_value = ssFile.str() ;
-					cid_value.erase(std::remove(cid_value.begin(), cid_value.end(), '\n'), cid_value.end());
-				} else {
-					vt_report_error(103, "DBLINK. Error reading <%s>", cid.substr(1).c_str());
-				}
+	} else {
+		vt_report_error(102, "DBLINK. Missing query parameter");
+	}
+
+	// Check connection parameters
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now() ;
+	if ( connect ) { 	// old VFQ connect style: connect='@/tmp/file.txt' will read CIDs from a different file
+		if ( cid[0] == '@' ) {
+			std::ifstream cids(cid.substr(1)) ;
+			if ( cids.is_open() ) {
+				std::stringstream ssFile;
+				ssFile << cids.rdbuf() ;
+				cid_value = ssFile.str() ;
+				cid_value.erase(std::remove(cid_value.begin(), cid_value.end(), '\n'), cid_value.end());
 			} else {
-				cid_value = cid ;
+				vt_report_error(103, "DBLINK. Error reading <%s>", cid.substr(1).c_str());
 			}
-		} else {			// new CID connect style:
-			std::ifstream cids(cid_file) ;
-			if ( cids.is_open() ) {
-				std::string cline ;
-				size_t pos ;
-				while ( getline(cids, cline) ) {
-					if ( cline[0] == '#' || cline.empty() )
-						continue ;	// skip empty lines & comments
-					if ( ( pos = cline.find(":") ) != std::string::npos ) {
-						cid_name = cline.substr(0, pos) ;
-						if ( cid_name == cid )
-							cid_value = cline.substr(pos + 1, std::string::npos ) ;
-						else if ( cid_name == cid + "$" ) {
-							cid_env = cline.substr(pos + 1, std::string::npos ) ;
-							std::stringstream se_stream ( cid_env ) ; 
-							std::string token ;
-							while ( std::getline ( se_stream, token, ';' ) ) { 
-								size_t pos = 0 ; 
-								if ( ( pos = token.find('=') ) && pos != std::string::npos ) { 
+		} else {
+			cid_value = cid ;
+		}
+	} else {			// new CID connect style:
+		// A list or pattern of CIDs runs the query on each of them (shards), described on the first one:
+		if ( cid.find_first_of(",*?") != std::string::npos ) {
+			if ( !registry.cids(cid_file, cid, ctx->shards) ) {
+				vt_report_error(104, "DBLINK. Error reading <%s>", cid_file.c_str());
+			}
+			if ( ctx->shards.empty() || ctx->shards.size() > MAX_SHARDS ) {
+				vt_report_error(136, "DBLINK. <%s> must match 1 to %d CIDs in <%s>", cid.c_str(), MAX_SHARDS, cid_file.c_str());
+			}
+		}
+		for ( size_t s = 0 ; s < std::max(ctx->shards.size(), (size_t)1) ; s++ ) {
+			std::string name = ctx->shards.empty() ? cid : ctx->shards[s] ;
+			std::string cid_admit ;
+			if ( registry.cid(cid_file, name, cid_value, cid_env, cid_admit) ) {
+				std::stringstream se_stream ( cid_env ) ;
+				std::string token ;
+				while ( std::getline ( se_stream, token, ';' ) ) {
+					size_t pos = 0 ;
+					if ( ( pos = token.find('=') ) && pos != std::string::npos ) {
 #ifdef DBLINK_DEBUG
   srvInterface.log("DEBUG DBLINK setting <%s> to <%s>", token.substr(0, pos).c_str(), token.substr(pos+1).c_str() );
 #endif
-									setenv ( token.substr(0, pos).c_str(), token.substr(pos + 1).c_str(), 1); 
-								}   
-							}   
-						}
-					} else {
-						continue ;	// skip malformed lines
+						setenv ( token.substr(0, pos).c_str(), token.substr(pos + 1).c_str(), 1);
 					}
 				}
-				cids.close() ;
 			} else {
-				vt_report_error(104, "DBLINK. Error reading <%s>", cid_file);
+				vt_report_error(104, "DBLINK. Error reading <%s>", cid_file.c_str());
 			}
 			if ( cid_value.empty() ) {
-				vt_report_error(105, "DBLINK. Error finding CID <%s> in <%s>", cid.c_str(), DBLINK_CIDS);
+				vt_report_error(105, "DBLINK. Error finding CID <%s> in <%s>", name.c_str(), cid_file.c_str());
 			}
+			Admission adm ;
+			adm.cid = name ;
+			if ( !adm.parse(cid_admit) ) {
+				vt_report_error(147, "DBLINK. Invalid admission entry <%s%%:%s> in <%s> (max, wait and dir keys)", name.c_str(), cid_admit.c_str(), cid_file.c_str());
+			}
+			ctx->admits.push_back(adm) ;
+			if ( !ctx->shards.empty() )
+				ctx->shard_cs.push_back(cid_value) ;
 		}
+		if ( !ctx->shards.empty() )
+			cid_value = ctx->shard_cs[0] ;
+	}
 
-		// Check if "query" is a script file name:
-        if ( query[0] == '@' ) {
-            std::ifstream qscript(query.substr(1)) ;
-			if ( qscript.is_open() ) {
-				std::stringstream ssFile;
-				ssFile << qscript.rdbuf() ;
-				query = ssFile.str() ;
-			} else {
-				vt_report_error(106, "DBLINK. Error reading query from <%s>", query.substr(1).c_str());
-			}
+	ctx->stats.cids = secs_since(t0) ;
+
+	// Check if "query" is a script file name:
+    if ( ctx->query[0] == '@' ) {
+        std::ifstream qscript(ctx->query.substr(1)) ;
+		if ( qscript.is_open() ) {
+			std::stringstream ssFile;
+			ssFile << qscript.rdbuf() ;
+			ctx->query = ssFile.str() ;
+		} else {
+			vt_report_error(106, "DBLINK. Error reading query from <%s>", ctx->query.substr(1).c_str());
 		}
+	}
 
-		// ODBC Connection:
-		if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_ENV, (SQLHANDLE)SQL_NULL_HANDLE, &Oenv))){
-			ex_err(0, 0, 107, "Error allocating Environment Handle");
+	// Local result cache (plain SELECTs): a valid entry describes the call, no connection needed
+	if( params.containsParameter("cache_ttl") ) {
+		vint ttl = params.getIntRef("cache_ttl") ;
+		std::string nq = cache_query(ctx->query) ;
+		if ( ttl < 0 ) {
+			vt_report_error(132, "DBLINK. cache_ttl must be >= 0");
+		}
+		if ( ( params.containsParameter("mode") && strcasecmp(params.getStringRef("mode").str().c_str(), "query") ) ||
+				params.containsParameter("split_column") || !ctx->shards.empty() || params.containsParameter("watermark_column") ||
+				params.containsParameter("chunk_column") || strncasecmp(nq.c_str(), "SELECT", 6) ) {
+			vt_report_error(133, "DBLINK. cache_ttl needs a SELECT query in query mode, without split_column, shards, watermark_column or chunk_column");
+		}
+		ctx->cache_max = (uint64)DEF_CACHE_MB << 20 ;
+		if( params.containsParameter("cache_max_mb") ) {
+			vint mb = params.getIntRef("cache_max_mb") ;
+			if ( mb < 1 || mb > MAX_CACHE_MB ) {
+				vt_report_error(134, "DBLINK. cache_max_mb out of range [1, %d]", MAX_CACHE_MB);
+			}
+			ctx->cache_max = (uint64)mb << 20 ;
+		}
+		ctx->cache_dir = params.containsParameter("cache_dir") ? params.getStringRef("cache_dir").str() : DBLINK_CACHE_DIR ;
+		if ( ttl > 0 ) {
+			char name[40] ;
+			std::string key = cid_value + '\x1f' + nq + '\x1f' +
+				( params.containsParameter("wide_char") && params.getBoolRef("wide_char") == VTrue ? "w" : "-" ) + '\x1f' +
+				( params.containsParameter("timestamptz") ? params.getStringRef("timestamptz").str() : "-" ) ;
+			ctx->cache_hash[0] = fnv1a(key, 0xcbf29ce484222325ULL) ;
+			ctx->cache_hash[1] = fnv1a(key, 0x6c62272e07bb0142ULL) ;
+			snprintf(name, sizeof(name), "%016llx%016llx.dbc", (unsigned long long)ctx->cache_hash[0], (unsigned long long)ctx->cache_hash[1]) ;
+			ctx->cache_path = ctx->cache_dir + "/" + name ;
+			t0 = std::chrono::steady_clock::now() ;
+			if ( describe_cached(ctx, outputTypes, (int64)ttl) ) {
+				srvInterface.log("DBLINK result set served from the local cache (%llu rows)", (unsigned long long)ctx->cache->head->rows) ;
+				ctx->is_select = true ;
+				ctx->query = nq ;
+				ctx->stats.describe = secs_since(t0) ;
+				return ctx ;
+			}
 		}
-		if (!SQL_SUCCEEDED(Oret=SQLSetEnvAttr(Oenv, SQL_ATTR_ODBC_VERSION, (void *) SQL_OV_ODBC3, 0))){
-			ex_err(0, 0, 108, "Error setting SQL_OV_ODBC3");
+	}
+
+	// ODBC Connection, with the streaming profile of the remote DBMS: known from a previous
+	// call or asked to this connection, replaced if the profile adds connection options
+	std::string streaming = params.containsParameter("streaming") ? params.getStringRef("streaming").str() : "off" ;
+	bool autodetect = !strcasecmp(streaming.c_str(), "auto") ;
+	DBs Odbt = GENERIC ;
+	bool known = registry.dbms(cid_value, Odbt) ;
+	if ( autodetect ) {
+		if ( known )
+			ctx->profile = &profiles[Odbt] ;
+	} else if ( strcasecmp(streaming.c_str(), "off") ) {
+		for ( size_t p = 0 ; p < sizeof(profiles) / sizeof(profiles[0]) && !ctx->profile ; p++ )
+			if ( !strcasecmp(streaming.c_str(), profiles[p].name) )
+				ctx->profile = &profiles[p] ;
+		if ( !ctx->profile ) {
+			vt_report_error(143, "DBLINK. Unknown streaming profile <%s> (auto, off, generic, postgres, vertica, sqlserver, teradata, oracle or mysql)", streaming.c_str());
 		}
-		if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_DBC, Oenv, &Ocon))){
-			ex_err(0, 0, 109, "Error allocating Connection Handle");
+	}
+	ctx->connstr = ctx->profile ? profile_connstr(cid_value, *ctx->profile) : cid_value ;
+	ctx->pooling = !params.containsParameter("pool") || params.getBoolRef("pool") != VFalse ;
+	t0 = std::chrono::steady_clock::now() ;
+	double waited = 0 ;
+	ctx->Ocon = registry.connect(ctx->connstr, ctx->admission(0), 107, &waited) ;
+	ctx->stats.wait(waited) ;
+	if ( !known ) {
+		SQLCHAR Odbms[64] = { 0 } ;
+		(void)SQLGetInfo(ctx->Ocon, SQL_DBMS_NAME, (SQLPOINTER)Odbms, (SQLSMALLINT)sizeof(Odbms), NULL) ;
+		Odbt = dbms_type((char *)Odbms) ;
+		registry.learn(cid_value, Odbt) ;
+	}
+	if ( autodetect && !ctx->profile ) {
+		ctx->profile = &profiles[Odbt] ;
+		if ( profile_connstr(cid_value, *ctx->profile) != ctx->connstr ) {
+			registry.release(ctx->connstr, ctx->Ocon, ctx->pooling) ;
+			ctx->Ocon = 0 ;
+			ctx->connstr = profile_connstr(cid_value, *ctx->profile) ;
+			ctx->Ocon = registry.connect(ctx->connstr, ctx->admission(0), 107, &waited) ;
+			ctx->stats.wait(waited) ;
 		}
-		if (!SQL_SUCCEEDED(Oret=SQLDriverConnect(Ocon, (SQLHWND)NULL, (SQLCHAR *)cid_value.c_str(), SQL_NTS, NULL, 0, NULL, SQL_DRIVER_NOPROMPT))){
-			ex_err(SQL_HANDLE_DBC, Ocon, 110, "Error connecting to target database");
+	}
+	if ( ctx->profile ) {
+		srvInterface.log("DBLINK streaming profile %s%s%s", ctx->profile->name, *ctx->profile->options ? ": " : "", ctx->profile->options) ;
+		for ( size_t k = 1 ; k < ctx->shard_cs.size() ; k++ )
+			ctx->shard_cs[k] = profile_connstr(ctx->shard_cs[k], *ctx->profile) ;
+		if ( !ctx->shard_cs.empty() )
+			ctx->shard_cs[0] = ctx->connstr ;
+	}
+	ctx->stats.connect = secs_since(t0) ;
+	t0 = std::chrono::steady_clock::now() ;
+
+	// Determine Statement type:
+	ctx->query.erase(0, ctx->query.find_first_not_of(" \n\t\r")) ;
+	ctx->is_select = !strncasecmp(ctx->query.c_str(), "SELECT", 6) ;
+	if( params.containsParameter("mode") ) {
+		std::string mode = params.getStringRef("mode").str() ;
+		if ( !strcasecmp(mode.c_str(), "sink") ) {
+			ctx->mode = MODE_SINK ;
+			ctx->is_select = false ;
+		} else if ( !strcasecmp(mode.c_str(), "lookup") ) {
+			if ( !ctx->is_select ) {
+				vt_report_error(130, "DBLINK. Lookup mode needs a SELECT query");
+			}
+			ctx->mode = MODE_LOOKUP ;
+		} else if ( !strcasecmp(mode.c_str(), "script") ) {
+			ctx->mode = MODE_SCRIPT ;
+			ctx->is_select = false ;
+		} else if ( strcasecmp(mode.c_str(), "query") ) {
+			vt_report_error(128, "DBLINK. Unknown mode <%s> (query, sink, lookup or script)", mode.c_str());
 		}
+	}
 
-		// Determine Statement type:
-		query.erase(0, query.find_first_not_of(" \n\t\r")) ;
-		if ( !strncasecmp(query.c_str(), "SELECT", 6) )
-			is_select = true ;
+	// Incremental extraction: only the rows above the watermark saved by the last successful call,
+	// bound as parameter of the wrapped query
+	if( params.containsParameter("watermark_column") ) {
+		if ( !ctx->is_select || ctx->mode != MODE_QUERY || params.containsParameter("split_column") ||
+				!ctx->shards.empty() || params.containsParameter("cache_ttl") ) {
+			vt_report_error(139, "DBLINK. watermark_column needs a SELECT query in query mode, without split_column, shards or cache_ttl");
+		}
+		// Calls run on any node: a node local default directory would lose the state
+		if ( !params.containsParameter("watermark_dir") ) {
+			vt_report_error(151, "DBLINK. watermark_column needs watermark_dir, a directory shared by all the nodes");
+		}
+		ctx->wm_col = params.getStringRef("watermark_column").str() ;
+		ctx->wm_path = state_path(params, cid_value + '\x1f' + cache_query(ctx->query) + '\x1f' + ctx->wm_col, "wm") ;
+		if ( wm_read(ctx->wm_path, ctx->wm_value) ) {
+			ctx->query.erase(ctx->query.find_last_not_of(" \n\t\r;") + 1) ;
+			ctx->query = "SELECT * FROM (" + ctx->query + ") dblink_w WHERE " + ctx->wm_col + " > ?" ;
+		}
+	}
 
-		// ODBC Statement preparation:
-		if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, Ocon, &Ost))){
-			ex_err(SQL_HANDLE_DBC, Ocon, 111, "Error allocating Statement Handle");
+	// Chunked extraction: the query runs as chunks ordered on the (unique) chunk column
+	if( params.containsParameter("chunk_column") ) {
+		if ( !ctx->is_select || ctx->mode != MODE_QUERY || params.containsParameter("split_column") ||
+				!ctx->shards.empty() || params.containsParameter("cache_ttl") || params.containsParameter("watermark_column") ) {
+			vt_report_error(144, "DBLINK. chunk_column needs a SELECT query in query mode, without split_column, shards, cache_ttl or watermark_column");
 		}
-		if ( is_select ) {
-			if (!SQL_SUCCEEDED(Oret=SQLPrepare(Ost, (SQLCHAR *)query.c_str(), SQL_NTS))) {
-				ex_err(SQL_HANDLE_STMT, Ost, 112, "Error preparing the statement");
-    		}
-			if (!SQL_SUCCEEDED(Oret=SQLNumResultCols(Ost, (SQLSMALLINT *)&Oncol))) {
-				ex_err(SQL_HANDLE_STMT, Ost, 115, "Error finding the number of resulting columns");
+		ctx->chunk_rows = DEF_CHUNK_ROWS ;
+		if( params.containsParameter("chunk_rows") ) {
+			vint n = params.getIntRef("chunk_rows") ;
+			if ( n < 1 ) {
+				vt_report_error(145, "DBLINK. chunk_rows must be > 0");
 			}
-			if ( (Odt = (SQLSMALLINT *)calloc ((size_t)Oncol, sizeof(SQLSMALLINT))) == (void *)NULL ) {
-				ex_err(0, 0, 116, "Error allocating data types array");
-    		}
-			if ( (Ors = (SQLULEN *)calloc ((size_t)Oncol, sizeof(SQLULEN))) == (void *)NULL ) {
-				ex_err(0, 0, 117, "Error allocating result set columns size array");
-    		}
-			if ( (desz = (size_t *)calloc ((size_t)Oncol, sizeof(size_t))) == (void *)NULL ) {
-				ex_err(0, 0, 118, "Error allocating data element size array");
-    		}
-			if ( (Odd = (SQLSMALLINT *)calloc ((size_t)Oncol, sizeof(SQLSMALLINT))) == (void *)NULL ) {
-				ex_err(0, 0, 119, "Error allocating result set decimal size array");
-    		}
-			for ( unsigned int j = 0 ; j < Oncol ; j++ ) {
-				SQLLEN Ool = 0 ;
-				if ( !SQL_SUCCEEDED(Oret=SQLDescribeCol(Ost, (SQLUSMALLINT)(j+1),
-                		Ocname, (SQLSMALLINT) MAXCNAMELEN, &Onamel,
-                		&Odt[j], &Ors[j], &Odd[j], &Onull))) {
-					ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description");
+			ctx->chunk_rows = (size_t)n ;
+		}
+		ctx->wm_col = params.getStringRef("chunk_column").str() ;
+		ctx->query.erase(ctx->query.find_last_not_of(" \n\t\r;") + 1) ;
+	}
+
+	// ODBC Statement preparation:
+	if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, ctx->Ocon, &ctx->Ost))){
+		ex_err(SQL_HANDLE_DBC, ctx->Ocon, 111, "Error allocating Statement Handle");
+	}
+	if ( ctx->profile )
+		stream_stmt(ctx->Ost) ;
+	if ( ctx->is_select ) {
+		bool tzsrc = params.containsParameter("timestamptz") ;	// remote timestamps are TIMESTAMPTZ
+		bool wide = params.containsParameter("wide_char") && params.getBoolRef("wide_char") == VTrue ;
+
+		// Column plans from the describe cache, or described on the zero-row query (the query
+		// itself if the remote database rejects it). The statement then gets the query.
+		std::string dpath ;
+		bool cached = false, zero = true ;
+		if ( !planned.empty() ) {
+			if ( !plan_read(planned, *ctx, outputTypes) ) {
+				vt_report_error(149, "DBLINK. Invalid DBLinkSource plan");
+			}
+			cached = true ;
+		} else if( params.containsParameter("describe_ttl") ) {
+			vint ttl = params.getIntRef("describe_ttl") ;
+			if ( ttl < 0 ) {
+				vt_report_error(146, "DBLINK. describe_ttl must be >= 0");
+			}
+			std::string key = cid_value + '\x1f' + cache_query(ctx->query) + '\x1f' + ( wide ? "w" : "-" ) + '\x1f' +
+				( tzsrc ? params.getStringRef("timestamptz").str() : "-" ) + '\x1f' + ( ctx->mode == MODE_LOOKUP ? "l" : "q" ) ;
+			char name[48] ;
+			snprintf(name, sizeof(name), "/%016llx%016llx.dsc", (unsigned long long)fnv1a(key, 0xcbf29ce484222325ULL),
+				(unsigned long long)fnv1a(key, 0x6c62272e07bb0142ULL)) ;
+			if ( ttl > 0 ) {			// describe_refresh: describe again, replacing the entry
+				dpath = ( params.containsParameter("cache_dir") ? params.getStringRef("cache_dir").str() : DBLINK_CACHE_DIR ) + name ;
+				cached = !( params.containsParameter("describe_refresh") && params.getBoolRef("describe_refresh") == VTrue ) &&
+					describe_load(dpath, (int64)ttl, *ctx, outputTypes) ;
+				if ( cached )
+					srvInterface.log("DBLINK result set described from the describe cache <%s>", dpath.c_str()) ;
+			}
+		}
+		if ( !cached ) {
+			std::string zq = ctx->zero_query(Odbt) ;
+			if ( !SQL_SUCCEEDED(Oret=SQLPrepare(ctx->Ost, (SQLCHAR *)zq.c_str(), SQL_NTS)) ||
+					!SQL_SUCCEEDED(Oret=SQLNumResultCols(ctx->Ost, (SQLSMALLINT *)&ctx->Oncol)) ) {
+				srvInterface.log("DBLINK zero-row describe rejected, describing the query. %s", odbc_diag(SQL_HANDLE_STMT, ctx->Ost).c_str()) ;
+				zero = false ;
+				(void)SQLFreeStmt(ctx->Ost, SQL_CLOSE) ;
+				if (!SQL_SUCCEEDED(Oret=SQLPrepare(ctx->Ost, (SQLCHAR *)ctx->query.c_str(), SQL_NTS))) {
+					ex_err(SQL_HANDLE_STMT, ctx->Ost, 112, "Error preparing the statement");
 				}
+				if (!SQL_SUCCEEDED(Oret=SQLNumResultCols(ctx->Ost, (SQLSMALLINT *)&ctx->Oncol))) {
+					ex_err(SQL_HANDLE_STMT, ctx->Ost, 115, "Error finding the number of resulting columns");
+				}
+			}
+		}
+		for ( unsigned int j = 0 ; j < ctx->Oncol && !cached ; j++ ) {
+			SQLLEN Ool = 0 ;
+			ColPlan cp ;
+			if ( !SQL_SUCCEEDED(Oret=SQLDescribeCol(ctx->Ost, (SQLUSMALLINT)(j+1),
+            		Ocname, (SQLSMALLINT) MAXCNAMELEN, &Onamel,
+            		&cp.sqlt, &cp.size, &cp.decimals, &Onull))) {
+				ex_err(SQL_HANDLE_STMT, ctx->Ost, 120, "Error getting column description");
+			}
 #ifdef DBLINK_DEBUG
-  srvInterface.log("DEBUG DBLINK SQLDescribeCol src column=%u name=%s data_type=%d length=%zu", j, (char *)Ocname, Odt[j], Ors[j]);
+  srvInterface.log("DEBUG DBLINK SQLDescribeCol src column=%u name=%s data_type=%d length=%zu", j, (char *)Ocname, cp.sqlt, cp.size);
 #endif
-				std::string cname((char *)Ocname);
-				switch(Odt[j]) {
-					case SQL_SMALLINT:
-					case SQL_INTEGER:
-					case SQL_TINYINT:
-					case SQL_BIGINT:
-						// we change this later on if the remote db is Oracle
-						desz[j] = sizeof(vint) ;
-						outputTypes.addInt(cname) ;
-						break ;
-					case SQL_REAL:
-					case SQL_DOUBLE:
-					case SQL_FLOAT:
-						desz[j] = sizeof(vfloat) ;
-						outputTypes.addFloat(cname) ;
-						break ;
-					case SQL_NUMERIC:
-					case SQL_DECIMAL:
-						desz[j] = MAX_NUMERIC_CHARLEN ;
-						outputTypes.addNumeric((int32)Ors[j], (int32)Odd[j], cname) ;
+			std::string cname((char *)Ocname);
+			switch(cp.sqlt) {
+				case SQL_SMALLINT:
+				case SQL_INTEGER:
+				case SQL_TINYINT:
+				case SQL_BIGINT:
+					// bound as strings in buildPlan if the driver lacks SQL_C_SBIGINT
+					cp.set(sizeof(vint), SQL_C_SBIGINT, CK_INT) ;
+					break ;
+				case SQL_REAL:
+				case SQL_DOUBLE:
+				case SQL_FLOAT:
+					cp.set(sizeof(vfloat), SQL_C_DOUBLE, CK_FLOAT) ;
+					break ;
+				case SQL_NUMERIC:
+				case SQL_DECIMAL:
+					// sign, leading zero, decimal point and terminator; drivers using exponents
+					// need a few more:
+					cp.set(cp.size && cp.size + 8 < MAX_NUMERIC_CHARLEN ? (size_t)cp.size + 8 : MAX_NUMERIC_CHARLEN,
+						SQL_C_CHAR, CK_NUMERIC) ;
+					break ;
+				case SQL_CHAR:
+				case SQL_WCHAR:
+					if ( wide && cp.sqlt == SQL_WCHAR ) {
+						wide_plan(cp, 65000) ;
 						break ;
-					case SQL_CHAR:
-					case SQL_WCHAR:
-						if( !SQL_SUCCEEDED(Oret=SQLColAttribute(Ost, (SQLUSMALLINT)(j+1), SQL_DESC_OCTET_LENGTH,
-							(SQLPOINTER) NULL, (SQLSMALLINT) 0, (SQLSMALLINT *) NULL, &Ool))) {
-								ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description");
-						}
+					}
+					if( !SQL_SUCCEEDED(Oret=SQLColAttribute(ctx->Ost, (SQLUSMALLINT)(j+1), SQL_DESC_OCTET_LENGTH,
+						(SQLPOINTER) NULL, (SQLSMALLINT) 0, (SQLSMALLINT *) NULL, &Ool))) {
+							ex_err(SQL_HANDLE_STMT, ctx->Ost, 120, "Error getting column description");
+					}
 #ifdef DBLINK_DEBUG
-  srvInterface.log("DEBUG DBLINK SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
+  srvInterface.log("DEBUG DBLINK SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, cp.sqlt, Ool);
 #endif
-						if ( Ool > 0 && (SQLULEN)Ool > Ors[j] ) 
-							Ors[j] = Ool ;
-						if ( Ors[j] > 65000 ) {
-  							srvInterface.log("DBLINK SQL_[W]CHAR column %s of length %zu limited to 65000 bytes", (char *)Ocname, Ors[j]);
-							Ors[j] = 65000;
-						}
-						desz[j] = (size_t)(Ors[j] + 1) ;
-						if ( !Ors[j] )
-							Ors[j] = 1 ;
-						outputTypes.addChar((int32)Ors[j], cname) ;
+					if ( Ool > 0 && (SQLULEN)Ool > cp.size ) 
+						cp.size = Ool ;
+					if ( cp.size > 65000 ) {
+  							srvInterface.log("DBLINK SQL_[W]CHAR column %s of length %zu limited to 65000 bytes", (char *)Ocname, cp.size);
+						cp.size = 65000;
+					}
+					cp.set((size_t)(cp.size + 1), SQL_C_CHAR, CK_STRING) ;
+					if ( !cp.size )
+						cp.size = 1 ;
+					break ;
+				case SQL_VARCHAR:
+				case SQL_WVARCHAR:
+					if ( wide && cp.sqlt == SQL_WVARCHAR ) {
+						wide_plan(cp, 65000) ;
 						break ;
-					case SQL_VARCHAR:
-					case SQL_WVARCHAR:
-						if( !SQL_SUCCEEDED(Oret=SQLColAttribute(Ost, (SQLUSMALLINT)(j+1), SQL_DESC_OCTET_LENGTH,
-							(SQLPOINTER) NULL, (SQLSMALLINT) 0, (SQLSMALLINT *) NULL, &Ool))) {
-								ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description");
-						}
+					}
+					if( !SQL_SUCCEEDED(Oret=SQLColAttribute(ctx->Ost, (SQLUSMALLINT)(j+1), SQL_DESC_OCTET_LENGTH,
+						(SQLPOINTER) NULL, (SQLSMALLINT) 0, (SQLSMALLINT *) NULL, &Ool))) {
+							ex_err(SQL_HANDLE_STMT, ctx->Ost, 120, "Error getting column description");
+					}
 #ifdef DBLINK_DEBUG
-  srvInterface.log("DEBUG DBLINK SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
+  srvInterface.log("DEBUG DBLINK SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, cp.sqlt, Ool);
 #endif
-						if ( Ool > 0 && (SQLULEN)Ool > Ors[j] ) 
-							Ors[j] = Ool ;
-						if ( Ors[j] > 65000 ) {
-  							srvInterface.log("DBLINK SQL_[W]VARCHAR column %s of length %zu limited to 65000 bytes", (char *)Ocname, Ors[j]);
-							Ors[j] = 65000;
-						}
-						desz[j] = (size_t)(Ors[j] + 1) ;
-						if ( !Ors[j] )
-							Ors[j] = 1 ;
-						outputTypes.addVarchar((int32)Ors[j], cname) ;
+					if ( Ool > 0 && (SQLULEN)Ool > cp.size ) 
+						cp.size = Ool ;
+					if ( cp.size > 65000 ) {
+  							srvInterface.log("DBLINK SQL_[W]VARCHAR column %s of length %zu limited to 65000 bytes", (char *)Ocname, cp.size);
+						cp.size = 65000;
+					}
+					cp.set((size_t)(cp.size + 1), SQL_C_CHAR, CK_STRING) ;
+					if ( !cp.size )
+						cp.size = 1 ;
+					break ;
+				case SQL_LONGVARCHAR:
+				case SQL_WLONGVARCHAR:
+					if ( wide && cp.sqlt == SQL_WLONGVARCHAR ) {
+						if ( cp.size == 0 )		// unbounded
+							cp.size = MAX_LOB_LENGTH ;
+						wide_plan(cp, MAX_LOB_LENGTH) ;
 						break ;
-					case SQL_LONGVARCHAR:
-					case SQL_WLONGVARCHAR:
-						if( !SQL_SUCCEEDED(Oret=SQLColAttribute(Ost, (SQLUSMALLINT)(j+1), SQL_DESC_OCTET_LENGTH,
-							(SQLPOINTER) NULL, (SQLSMALLINT) 0, (SQLSMALLINT *) NULL, &Ool))) {
-								ex_err(SQL_HANDLE_STMT, Ost, 120, "Error getting column description");
-						}
+					}
+					if( !SQL_SUCCEEDED(Oret=SQLColAttribute(ctx->Ost, (SQLUSMALLINT)(j+1), SQL_DESC_OCTET_LENGTH,
+						(SQLPOINTER) NULL, (SQLSMALLINT) 0, (SQLSMALLINT *) NULL, &Ool))) {
+							ex_err(SQL_HANDLE_STMT, ctx->Ost, 120, "Error getting column description");
+					}
 #ifdef DBLINK_DEBUG
-  srvInterface.log("DEBUG DBLINK SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, Odt[j], Ool);
+  srvInterface.log("DEBUG DBLINK SQLColAttribute SQL_DESC_OCTET_LENGTH src column=%u name=%s data_type=%d length=%ld", j, (char *)Ocname, cp.sqlt, Ool);
 #endif
-						if ( Ool > 0 && (SQLULEN)Ool > Ors[j] ) 
-							Ors[j] = Ool ;
-						if ( Ors[j] > 32000000 ) {
-  							srvInterface.log("DBLINK SQL_LONG[W]VARCHAR column %s of length %zu limited to 32000000 bytes", (char *)Ocname, Ors[j]);
-							Ors[j] = 32000000;
-						}
-						desz[j] = (size_t)(Ors[j] + 1) ;
-						if ( !Ors[j] )
-							Ors[j] = 1 ;
-						outputTypes.addLongVarchar((int32)Ors[j], cname) ;
-						break ;
-					case SQL_TYPE_TIME:
-						desz[j] = sizeof(SQL_TIME_STRUCT) ;
-						outputTypes.addTime((int32)Odd[j], cname) ;
-						break ;
-					case SQL_TYPE_DATE:
-						desz[j] = sizeof(SQL_DATE_STRUCT) ;
-						outputTypes.addDate(cname) ;
-						break ;
-					case SQL_TYPE_TIMESTAMP:
-						desz[j] = sizeof(SQL_TIMESTAMP_STRUCT) ;
-						outputTypes.addTimestamp((int32)Odd[j], cname) ;
-						break ;
-					case SQL_BIT:
-						desz[j] = 1 ;
-						outputTypes.addBool(cname) ;
-						break ;
-					case SQL_BINARY:
-						if ( Ors[j] > 65000 ) {
-  							srvInterface.log("DBLINK SQL_BINARY column %s of length %zu limited to 65000 bytes", (char *)Ocname, Ors[j]);
-							Ors[j] = 65000;
-						}
-						desz[j] = (size_t)(Ors[j] + 1) ;
-						outputTypes.addBinary((int32)Ors[j], cname) ;
-						break ;
-					case SQL_VARBINARY:
-						if ( Ors[j] > 65000 ) {
-  							srvInterface.log("DBLINK SQL_VARBINARY column %s of length %zu limited to 65000 bytes", (char *)Ocname, Ors[j]);
-							Ors[j] = 65000;
-						}
-						desz[j] = (size_t)(Ors[j] + 1) ;
-						outputTypes.addVarbinary((int32)Ors[j], cname) ;
-						break ;
-					case SQL_LONGVARBINARY:
-						if ( Ors[j] > 32000000 ) {
-  							srvInterface.log("DBLINK SQL_LONGVARBINARY column %s of length %zu limited to 32000000 bytes", (char *)Ocname, Ors[j]);
-							Ors[j] = 32000000;
-						}
-						desz[j] = (size_t)(Ors[j] + 1) ;
-						outputTypes.addLongVarbinary((int32)Ors[j], cname) ;
-						break ;
-					case SQL_INTERVAL_YEAR_TO_MONTH:
-						desz[j] = sizeof(SQL_INTERVAL_STRUCT) ;
-						outputTypes.addIntervalYM(INTERVAL_YEAR2MONTH, cname) ;
-						break ;
-					case SQL_INTERVAL_DAY_TO_SECOND:			
-						desz[j] = sizeof(SQL_INTERVAL_STRUCT) ;
-						outputTypes.addInterval((int32)Odd[j], INTERVAL_DAY2SECOND, cname) ;
-						break ;
-					default:
-						vt_report_error(121, "DBLINK. Unsupported data type for column %u", j);
-				}
-        	}
-			colInfo = outputTypes ;
+					if ( Ool > 0 && (SQLULEN)Ool > cp.size ) 
+						cp.size = Ool ;
+					if ( cp.size == 0 || cp.size > MAX_LOB_LENGTH ) {	// 0: unbounded
+  							srvInterface.log("DBLINK SQL_LONG[W]VARCHAR column %s of length %zu limited to 32000000 bytes", (char *)Ocname, cp.size);
+						cp.size = MAX_LOB_LENGTH;
+					}
+					cp.set((size_t)(cp.size + 1), SQL_C_CHAR, CK_STRING) ;
+					if ( !cp.size )
+						cp.size = 1 ;
+					break ;
+				case SQL_TYPE_TIME:
+					cp.set(sizeof(SQL_TIME_STRUCT), SQL_C_TIME, CK_TIME) ;
+					break ;
+				case SQL_TYPE_DATE:
+					cp.set(sizeof(SQL_DATE_STRUCT), SQL_C_DATE, CK_DATE) ;
+					break ;
+				case SQL_TYPE_TIMESTAMP:
+					cp.set(sizeof(SQL_TIMESTAMP_STRUCT), SQL_C_TIMESTAMP, tzsrc ? CK_TIMESTAMPTZ : CK_TIMESTAMP) ;
+					break ;
+				case SQL_BIT:
+					cp.set(1, SQL_C_BIT, CK_BOOL) ;
+					break ;
+				case SQL_BINARY:
+					if ( cp.size > 65000 ) {
+  							srvInterface.log("DBLINK SQL_BINARY column %s of length %zu limited to 65000 bytes", (char *)Ocname, cp.size);
+						cp.size = 65000;
+					}
+					cp.set((size_t)(cp.size + 1), SQL_C_BINARY, CK_STRING) ;
+					break ;
+				case SQL_VARBINARY:
+					if ( cp.size > 65000 ) {
+  							srvInterface.log("DBLINK SQL_VARBINARY column %s of length %zu limited to 65000 bytes", (char *)Ocname, cp.size);
+						cp.size = 65000;
+					}
+					cp.set((size_t)(cp.size + 1), SQL_C_BINARY, CK_STRING) ;
+					break ;
+				case SQL_LONGVARBINARY:
+					if ( cp.size == 0 || cp.size > MAX_LOB_LENGTH ) {	// 0: unbounded
+  							srvInterface.log("DBLINK SQL_LONGVARBINARY column %s of length %zu limited to 32000000 bytes", (char *)Ocname, cp.size);
+						cp.size = MAX_LOB_LENGTH;
+					}
+					cp.set((size_t)(cp.size + 1), SQL_C_BINARY, CK_STRING) ;
+					break ;
+				case SQL_INTERVAL_YEAR_TO_MONTH:
+					cp.set(sizeof(SQL_INTERVAL_STRUCT), SQL_C_INTERVAL_YEAR_TO_MONTH, CK_INTERVAL_YM) ;
+					break ;
+				case SQL_INTERVAL_DAY_TO_SECOND:			
+					cp.set(sizeof(SQL_INTERVAL_STRUCT), SQL_C_INTERVAL_DAY_TO_SECOND, CK_INTERVAL_DS) ;
+					break ;
+				default:
+					vt_report_error(121, "DBLINK. Unsupported data type for column %u", j);
+			}
+			add_column(outputTypes, cp, cname) ;
+			ctx->Oplan.push_back(cp) ;
+    	}
+		if ( !cached && !dpath.empty() && !describe_save(dpath, *ctx, outputTypes) ) {
+			srvInterface.log("DBLINK cannot write the describe cache <%s>", dpath.c_str()) ;
+		}
+		// (planned COPY slices execute their own slice queries)
+		if ( ( cached || zero ) && ( planned.empty() || !params.containsParameter("split_column") ) &&
+				!SQL_SUCCEEDED(Oret=SQLPrepare(ctx->Ost, (SQLCHAR *)ctx->query.c_str(), SQL_NTS)) ) {
+			ex_err(SQL_HANDLE_STMT, ctx->Ost, 112, "Error preparing the statement");
+		}
+		ctx->colInfo = outputTypes ;
+		if ( !ctx->wm_col.empty() ) {
+			std::string wname = ctx->wm_col ;
+			const char *wparam = ctx->chunk_rows ? "chunk_column" : "watermark_column" ;
+			wname.erase(std::remove(wname.begin(), wname.end(), '"'), wname.end()) ;
+			for ( unsigned int j = 0 ; j < ctx->Oncol && ctx->wm_idx < 0 ; j++ )
+				if ( !strcasecmp(outputTypes.getColumnName(j).c_str(), wname.c_str()) )
+					ctx->wm_idx = (int)j ;
+			if ( ctx->wm_idx < 0 ) {
+				vt_report_error(140, "DBLINK. %s <%s> not found in the query result", wparam, ctx->wm_col.c_str());
+			}
+			// Character watermarks would be compared here byte by byte, and remotely with the
+			// remote collation: only chunk keys (in the remote order) can be strings
+			const ColPlan &cp = ctx->Oplan[ctx->wm_idx] ;
+			if ( !( cp.kind == CK_INT || cp.kind == CK_DATE || cp.kind == CK_TIMESTAMP || cp.kind == CK_TIMESTAMPTZ ||
+					( cp.kind == CK_STRING && cp.ctype == SQL_C_CHAR && cp.desz <= LOB_STREAM_MIN && ctx->chunk_rows ) ||
+					( cp.kind == CK_NUMERIC && cp.decimals == 0 && cp.size >= 1 && cp.size <= 18 ) ) ) {
+				vt_report_error(141, "DBLINK. %s <%s> must be %s", wparam, ctx->wm_col.c_str(),
+					ctx->chunk_rows ? "a unique integer, DATE, TIMESTAMP or character column" : "an integer, DATE or TIMESTAMP column");
+			}
+		}
+	} else if ( ctx->mode == MODE_SINK ) {
+		if (!SQL_SUCCEEDED(Oret=SQLPrepare(ctx->Ost, (SQLCHAR *)ctx->query.c_str(), SQL_NTS))) {
+			ex_err(SQL_HANDLE_STMT, ctx->Ost, 112, "Error preparing the statement");
+		}
+		if (!SQL_SUCCEEDED(Oret=SQLNumParams(ctx->Ost, &ctx->npar)) || ctx->npar < 1) {
+			vt_report_error(129, "DBLINK. Sink mode needs a query with parameter markers");
+		}
+		outputTypes.addInt("rows") ;
+	} else if ( ctx->mode == MODE_SCRIPT ) {
+		SQLCHAR Odbms[64] = { 0 } ;
+		std::map<std::string, size_t> seen ;
+		(void)SQLGetInfo(ctx->Ocon, SQL_DBMS_NAME, (SQLPOINTER)Odbms, (SQLSMALLINT)sizeof(Odbms), NULL) ;
+		ctx->script = split_script(ctx->query, dbms_type((char *)Odbms)) ;
+		if ( ctx->script.empty() ) {
+			vt_report_error(135, "DBLINK. Script mode: no statements in the query");
+		}
+		for ( size_t i = 0 ; i < ctx->script.size() ; i++ )
+			seen[ctx->script[i]]++ ;
+		for ( size_t i = 0 ; i < ctx->script.size() ; i++ )
+			ctx->script_rep.push_back(seen[ctx->script[i]] > 1) ;
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK script of %zu statements (%zu distinct)", ctx->script.size(), seen.size() );
+#endif
+		outputTypes.addInt("statement") ;
+		outputTypes.addVarchar(SCRIPT_SQL_LEN, "sql") ;
+		outputTypes.addInt("rows") ;
+		outputTypes.addFloat("secs") ;
+		outputTypes.addVarchar(32, "status") ;
+	} else {
+		outputTypes.addInt("dblink") ;
+	}
+
+	// Shards: the SELECT runs on each CID, rows optionally tagged with their CID
+	if ( !ctx->shards.empty() && ( !ctx->is_select || ctx->mode != MODE_QUERY || params.containsParameter("split_column") ) ) {
+		vt_report_error(137, "DBLINK. A list or pattern of CIDs needs a SELECT query in query mode, without split_column");
+	}
+	if( params.containsParameter("shard_column") ) {
+		if ( ctx->shards.empty() ) {
+			vt_report_error(138, "DBLINK. shard_column needs a list or pattern of CIDs");
+		}
+		outputTypes.addVarchar(MAXCNAMELEN, params.getStringRef("shard_column").str()) ;
+		ctx->shard_col = true ;
+	}
+
+	// Parallel extraction: compute the slice boundaries on the split column
+	if( params.containsParameter("split_column") ) {
+		if ( ctx->mode == MODE_LOOKUP ) {
+			vt_report_error(131, "DBLINK. split_column cannot be used in lookup mode");
+		}
+		if ( !ctx->is_select ) {
+			vt_report_error(122, "DBLINK. split_column requires a SELECT query");
+		}
+		ctx->split_col = params.getStringRef("split_column").str() ;
+		ctx->query.erase(ctx->query.find_last_not_of(" \n\t\r;") + 1) ;
+		if ( !planned.empty() ) {
+			// Cuts computed once by the COPY source plan, read with the description
+		} else if ( ninput >= 2 ) {
+			// Slice bounds in the input rows: computed once for all the nodes
+		} else if( params.containsParameter("split_bounds") ) {
+			std::stringstream sb_stream ( params.getStringRef("split_bounds").str() ) ;
+			std::string token ;
+			while ( std::getline ( sb_stream, token, ',' ) ) {
+				token.erase(0, token.find_first_not_of(" \n\t\r")) ;
+				token.erase(token.find_last_not_of(" \n\t\r") + 1) ;
+				if ( !token.empty() )
+					ctx->split_cuts.push_back(token) ;
+			}
+			if ( ctx->split_cuts.empty() || ctx->split_cuts.size() >= MAX_SPLIT ) {
+				vt_report_error(123, "DBLINK. split_bounds must contain 1 to %d values", MAX_SPLIT - 1);
+			}
+		} else if( params.containsParameter("split_count") ) {
+			vint nsplit = params.getIntRef("split_count") ;
+			SQLHSTMT Opst = 0 ;
+			SQLBIGINT Omm[2] = { 0, 0 } ;
+			SQLLEN Ommi[2] = { SQL_NULL_DATA, SQL_NULL_DATA } ;
+			std::string pquery = "SELECT MIN(" + ctx->split_col + "), MAX(" + ctx->split_col + ") FROM (" + ctx->query + ") dblink_p" ;
+
+			if ( nsplit < 1 || nsplit > MAX_SPLIT ) {
+				vt_report_error(124, "DBLINK. split_count out of range [1, %d]", MAX_SPLIT);
+			}
+			// Instances extracting the slices of their input rows would each probe the range,
+			// and get different cuts while the remote table changes
+			if ( ninput ) {
+				vt_report_error(148, "DBLINK. split_count cannot be used with slice numbers in input: use split_bounds or pass the slice bounds in input");
+			}
+			// Probe the remote split column range:
+			if (!SQL_SUCCEEDED(Oret=SQLAllocHandle(SQL_HANDLE_STMT, ctx->Ocon, &Opst))){
+				ex_err(SQL_HANDLE_DBC, ctx->Ocon, 125, "Error allocating Statement Handle");
+			}
+			if (!SQL_SUCCEEDED(Oret=SQLExecDirect(Opst, (SQLCHAR *)pquery.c_str(), SQL_NTS)) ||
+				!SQL_SUCCEEDED(Oret=SQLBindCol(Opst, 1, SQL_C_SBIGINT, &Omm[0], sizeof(SQLBIGINT), &Ommi[0])) ||
+				!SQL_SUCCEEDED(Oret=SQLBindCol(Opst, 2, SQL_C_SBIGINT, &Omm[1], sizeof(SQLBIGINT), &Ommi[1])) ||
+				!SQL_SUCCEEDED(Oret=SQLFetch(Opst))) {
+				ex_err(SQL_HANDLE_STMT, Opst, 126, "Error probing split column range (split_count needs an INTEGER split_column)");
+			}
+			(void)SQLFreeHandle(SQL_HANDLE_STMT, Opst);
+#ifdef DBLINK_DEBUG
+  srvInterface.log("DEBUG DBLINK split column %s range [%lld, %lld]", ctx->split_col.c_str(), (long long)Omm[0], (long long)Omm[1]);
+#endif
+			// Empty remote range: any cut value gives the right slices (all but the last are empty)
+			if ( Ommi[0] == SQL_NULL_DATA || Ommi[1] == SQL_NULL_DATA )
+				Omm[0] = Omm[1] = 0 ;
+			__int128 span = (__int128)Omm[1] - Omm[0] + 1 ;
+			for ( vint i = 1 ; i < nsplit ; i++ )
+				ctx->split_cuts.push_back(std::to_string((long long)(Omm[0] + span * i / nsplit))) ;
 		} else {
-			outputTypes.addInt("dblink") ;
+			vt_report_error(127, "DBLINK. split_column requires split_count, split_bounds or slice bounds in input");
 		}
+		// Slices run on their own connections
+		ctx->release() ;
+	}
+	// Admission control: the describe connection goes back to the pool with its slot, where the
+	// instances of this process reuse it, and where it is closed when the CID needs the slot
+	if ( !ctx->admits.empty() && ctx->admits[0].max )
+		ctx->release() ;
+	ctx->stats.describe = secs_since(t0) ;
+	return ctx ;
+}
+
+// Parameters of DBLINK() and of the DBLinkSource COPY source
+void add_parameters ( SizedColumnTypes &parameterTypes )
+{
+	parameterTypes.addVarchar(1024, "cid",  { true, false, false, "Connection Identifier Database. Identifies an entry in the connection identifier database. A comma separated list or pattern (* and ? wildcards) runs the query on each matching entry (shards)." });
+	parameterTypes.addVarchar(1024, "connect",  { true, false, false, "The ODBC connection string containing the DSN and credentials." });
+	parameterTypes.addVarchar(1024, "connect_secret",  { true, false, false, "The ODBC connection string containing the DSN and credentials." });
+	parameterTypes.addVarchar(1024, "cidfile",  { true, false, false, "Connection Identifier File Path." });
+	parameterTypes.addVarchar(65000, "query",  { true, false, false, "The query being pushed on the remote database. Or, '@' followed by the name of the file containing the query." });
+	parameterTypes.addInt("rowset",  { true, false, false, "Number of rows retrieved from the remote database during each SQLFetch() cycle. Default is 100." });
+	parameterTypes.addInt("fetch_buffer_mb",  { true, false, false, "Fetch buffers size in MB. The rowset is computed from the row width (instead of rowset)." });
+	parameterTypes.addBool("pool",  { true, false, false, "Reuse pooled connections to the remote database. Default is true." });
+	parameterTypes.addBool("async",  { true, false, false, "Execute the remote query asynchronously (polled, can be canceled). Default is true when the driver supports it." });
+	parameterTypes.addInt("query_timeout",  { true, false, false, "Cancel the remote execution after this number of seconds. Default is 0 (no timeout)." });
+	parameterTypes.addVarchar(1024, "stats_file",  { true, false, false, "Append the timings and counters of each partition to this file on the node." });
+	parameterTypes.addInt("cache_ttl",  { true, false, false, "Serve the result set from a local cache file younger than this number of seconds (0: no cache). SELECT queries only." });
+	parameterTypes.addVarchar(1024, "cache_dir",  { true, false, false, "Local result cache directory. Default is /tmp/dblink_cache." });
+	parameterTypes.addInt("cache_max_mb",  { true, false, false, "Local result cache size in MB (least recently used results are removed). Default is 1024." });
+	parameterTypes.addInt("describe_ttl",  { true, false, false, "Reuse the result set description saved in cache_dir less than this number of seconds ago (0: no describe cache)." });
+	parameterTypes.addBool("describe_refresh",  { true, false, false, "Describe the query again and replace its describe cache entry. Default is false." });
+	parameterTypes.addBool("wide_char",  { true, false, false, "Bind wide character columns as SQL_C_WCHAR and transcode them to UTF-8. Default is false." });
+	parameterTypes.addBool("numeric_native",  { true, false, false, "Bind NUMERIC columns as SQL_C_NUMERIC structures. Default is false." });
+	parameterTypes.addBool("lob_stream",  { true, false, false, "Read long columns in chunks with SQLGetData instead of binding them. Default is true." });
+	parameterTypes.addBool("rowset_adaptive",  { true, false, false, "Grow/shrink the number of rows per fetch between calls based on the fetch latency." });
+	parameterTypes.addVarchar(16, "timestamptz",  { true, false, false, "UTC offset of the remote timestamps (for example '+02:00' or 'UTC'). Timestamps are returned as TIMESTAMPTZ." });
+	parameterTypes.addVarchar(16, "streaming",  { true, false, false, "Streaming profile: off (default), auto (from the remote DBMS), or generic, postgres, vertica, sqlserver, teradata, oracle, mysql." });
+	parameterTypes.addInt("pipeline",  { true, false, false, "Number of rowset buffers fetched by a background thread while the current one is converted. Default is 0 (disabled)." });
+	parameterTypes.addVarchar(16, "mode",  { true, false, false, "query (default): return the query result set. sink: run the parameterized query for each input row. lookup: run the query for the input keys. script: run the statements of the query, one row per statement." });
+	parameterTypes.addInt("batch_size",  { true, false, false, "Sink/lookup modes: number of input rows (keys) sent in each batch. Default is 1000." });
+	parameterTypes.addBool("transaction",  { true, false, false, "Script mode: run all the statements in one transaction, committed at the end. Default is false." });
+	parameterTypes.addInt("commit_batches",  { true, false, false, "Sink mode: commit every N batches. Default is 0 (commit at the end of each partition)." });
+	parameterTypes.addVarchar(MAXCNAMELEN, "watermark_column",  { true, false, false, "Incremental extraction: only return the rows where this column is above the value saved by the last call." });
+	parameterTypes.addVarchar(1024, "watermark_dir",  { true, false, false, "Incremental extraction state directory, on storage shared by all the nodes. Required with watermark_column." });
+	parameterTypes.addVarchar(MAXCNAMELEN, "chunk_column",  { true, false, false, "Chunked extraction: run the query in chunks ordered on this unique column, each one above the last key returned (rows with a NULL key last)." });
+	parameterTypes.addInt("chunk_rows",  { true, false, false, "Chunked extraction: rows per chunk. Default is 100000." });
+	parameterTypes.addInt("chunk_retries",  { true, false, false, "Chunked extraction: retries of a failed chunk, on a new connection. Default is 3." });
+	parameterTypes.addVarchar(MAXCNAMELEN, "shard_column",  { true, false, false, "Shards: name of an extra column returning the CID of each row." });
+	parameterTypes.addVarchar(1024, "split_column",  { true, false, false, "Query column used to split the extraction in slices running in parallel." });
+	parameterTypes.addInt("split_count",  { true, false, false, "Number of slices. The split column range is probed on the remote database (INTEGER columns only)." });
+	parameterTypes.addVarchar(65000, "split_bounds",  { true, false, false, "Comma separated list of split column values used as slice boundaries." });
+}
+
+class DBLinkFactory : public TransformFunctionFactory
+{
+	virtual void getPrototype(ServerInterface &srvInterface,
+                              ColumnTypes &argTypes,
+                              ColumnTypes &returnType )
+	{
+		argTypes.addAny();
+		returnType.addAny();
+	}
+	virtual void getReturnType(ServerInterface &srvInterface,
+                               const SizedColumnTypes &inputTypes,
+                               SizedColumnTypes &outputTypes )
+	{
+		std::shared_ptr<Context> ctx = describe(srvInterface, outputTypes, inputTypes.getColumnCount()) ;
+		srvInterface.log("DBLINK describe stats: %s", ctx->stats.line().c_str()) ;
+		contexts.put(context_key(srvInterface), ctx) ;
 	}
     virtual void getParameterType(ServerInterface &srvInterface, SizedColumnTypes &parameterTypes)
 	{
-		parameterTypes.addVarchar(1024, "cid",  { true, false, false, "Connection Identifier Database. Identifies an entry in the connection identifier database." });
-		parameterTypes.addVarchar(1024, "connect",  { true, false, false, "The ODBC connection string containing the DSN and credentials." });
-		parameterTypes.addVarchar(1024, "connect_secret",  { true, false, false, "The ODBC connection string containing the DSN and credentials." });
-		parameterTypes.addVarchar(1024, "cidfile",  { true, false, false, "Connection Identifier File Path." });
-		parameterTypes.addVarchar(65000, "query",  { true, false, false, "The query being pushed on the remote database. Or, '@' followed by the name of the file containing the query." });
-		parameterTypes.addInt("rowset",  { true, false, false, "Number of rows retrieved from the remote database during each SQLFetch() cycle. Default is 100." });
+		add_parameters(parameterTypes) ;
 	}
 
 	virtual TransformFunction *createTransformFunction( ServerInterface &srvInterface )
@@ -747,6 +4629,128 @@ class DBLinkFactory : public TransformFunctionFactory
 };
 RegisterFactory(DBLinkFactory);
 
+// COPY source: COPY t WITH SOURCE DBLinkSource(cid=..., query=...) NATIVE. Each source runs the
+// query (or one split slice) through a DBLink instance and writes its rows in the NATIVE format.
+// The embedded DBLink is no TransformFunction called by Vertica: cancel() is forwarded to it.
+class DBLinkSource : public UDSource
+{
+	DBLink link ;				// Connection, fetch and conversion
+	long slice ;				// Split slice extracted by this source, -1 for the whole query
+	std::unique_ptr<NativeWriter> writer ;
+	bool done ;
+
+public:
+	DBLinkSource ( long s, const std::string &planned ) : slice(s), done(false) {
+		link.Iplanned = planned ;
+	}
+
+	virtual void setup(ServerInterface &srvInterface)
+	{
+		try {
+			link.setup(srvInterface, SizedColumnTypes()) ;
+			link.sourceExecute(srvInterface, slice) ;
+			writer.reset(new NativeWriter(link.ctx->Oplan)) ;
+		} catch (exception& e) {
+			link.cleanInstance() ;
+			vt_report_error(500, "Exception while setting up the source: [%s]", e.what());
+		}
+	}
+
+	// Fill the COPY buffer: the rows left from the last rowset first, then new rowsets
+	virtual StreamState process(ServerInterface &srvInterface, DataBuffer &output)
+	{
+		try {
+			for ( ; ; ) {
+				output.offset += writer->drain(output.buf + output.offset, output.size - output.offset) ;
+				if ( output.offset == output.size )
+					return OUTPUT_NEEDED ;
+				if ( done )
+					break ;
+				done = !link.fetchRowset(*writer) || link.canceled() ;
+			}
+		} catch (exception& e) {
+			link.reportStats(srvInterface) ;
+			link.cleanInstance() ;
+			vt_report_error(501, "Exception while fetching the source rows: [%s]", e.what());
+		}
+		link.reportStats(srvInterface) ;
+		return DONE ;
+	}
+
+	virtual void cancel(ServerInterface &srvInterface)
+	{
+		link.cancel(srvInterface) ;
+	}
+
+	virtual void destroy(ServerInterface &srvInterface)
+	{
+		link.destroy(srvInterface, SizedColumnTypes()) ;
+		writer.reset() ;
+	}
+} ;
+
+class DBLinkSourceFactory : public SourceFactory
+{
+	// Describe the load on the initiator, then spread the split slices (or the whole query)
+	// over the nodes. The initiator gets the first one: it keeps the describe connection.
+	// The description and the split cuts go to every node in the plan.
+	virtual void plan(ServerInterface &srvInterface, NodeSpecifyingPlanContext &planCtxt)
+	{
+		SizedColumnTypes outputTypes ;
+		std::shared_ptr<Context> ctx = describe(srvInterface, outputTypes) ;
+		if ( !ctx->is_select || ctx->mode != MODE_QUERY || ctx->cache || !ctx->shards.empty() || !ctx->wm_col.empty() ) {
+			vt_report_error(142, "DBLINK. DBLinkSource needs a SELECT query in query mode, without shards, cache_ttl, watermark_column or chunk_column");
+		}
+		std::string planned = plan_text(*ctx, outputTypes) ;
+		if ( planned.empty() ) {
+			vt_report_error(150, "DBLINK. DBLinkSource cannot plan column names with new lines");
+		}
+		srvInterface.log("DBLINK describe stats: %s", ctx->stats.line().c_str()) ;
+		contexts.put(context_key(srvInterface), ctx) ;
+		planCtxt.getWriter().getStringRef("plan").copy(planned) ;
+
+		std::vector<std::string> nodes(1, srvInterface.getCurrentNodeName()), targets ;
+		const std::vector<std::string> &cluster = planCtxt.getClusterNodes() ;
+		for ( size_t n = 0 ; n < cluster.size() ; n++ )
+			if ( cluster[n] != nodes[0] )
+				nodes.push_back(cluster[n]) ;
+		std::vector<std::string> slices(nodes.size()) ;
+		if ( ctx->split_col.empty() ) {
+			slices[0] = "-1" ;
+		} else {
+			for ( size_t s = 0 ; s <= ctx->split_cuts.size() ; s++ )
+				slices[s % nodes.size()] += ( s < nodes.size() ? "" : "," ) + std::to_string((long long)s) ;
+		}
+		for ( size_t n = 0 ; n < nodes.size() ; n++ ) {
+			if ( slices[n].empty() )
+				continue ;
+			planCtxt.getWriter().getStringRef("slices_" + nodes[n]).copy(slices[n]) ;
+			targets.push_back(nodes[n]) ;
+		}
+		planCtxt.setTargetNodes(targets) ;
+	}
+
+	// One source per slice assigned to this node
+	virtual std::vector<UDSource *> prepareUDSources(ServerInterface &srvInterface, NodeSpecifyingPlanContext &planCtxt)
+	{
+		std::vector<UDSource *> sources ;
+		std::string key = "slices_" + srvInterface.getCurrentNodeName() ;
+		if ( !planCtxt.getReader().containsParameter(key) )
+			return sources ;
+		std::istringstream list(planCtxt.getReader().getStringRef(key).str()) ;
+		std::string planned = planCtxt.getReader().getStringRef("plan").str() ;
+		for ( std::string s ; std::getline(list, s, ',') ; )
+			sources.push_back(vt_createFuncObject<DBLinkSource>(srvInterface.allocator, atol(s.c_str()), planned)) ;
+		return sources ;
+	}
+
+	virtual void getParameterType(ServerInterface &srvInterface, SizedColumnTypes &parameterTypes)
+	{
+		add_parameters(parameterTypes) ;
+	}
+} ;
+RegisterFactory(DBLinkSourceFactory);
+
 RegisterLibrary (
 	"Maurizio Felici",
 	__DATE__,